@@ -0,0 +1,122 @@
+/* Compare intrusive_list::sort with an inlined comparator against the same
+ * merge sort driven through a C-style function pointer.
+ *
+ * Build: g++ -O2 -std=c++17 -o intrusive_bench intrusive_bench.cpp
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "intrusive_list.hpp"
+
+/* Same node layout as main2.c */
+struct listitem {
+    uint16_t i;
+    struct list_head list;
+};
+
+typedef intrusive_list<listitem, &listitem::list> item_list;
+
+static_assert(sizeof(item_list) == sizeof(struct list_head),
+              "intrusive_list must stay layout-compatible with list_head");
+
+static int cmpint(const void *p1, const void *p2)
+{
+    const uint16_t *i1 = (const uint16_t *) p1;
+    const uint16_t *i2 = (const uint16_t *) p2;
+
+    return *i1 - *i2;
+}
+
+struct item_less {
+    bool operator()(const listitem &a, const listitem &b) const
+    {
+        return a.i < b.i;
+    }
+};
+
+/* Comparator that can only be reached through a pointer, like qsort(). */
+struct fp_less {
+    int (*cmp)(const void *, const void *);
+    bool operator()(const listitem &a, const listitem &b) const
+    {
+        return cmp(&a.i, &b.i) < 0;
+    }
+};
+
+__attribute__((noinline)) static void sort_fp(
+    item_list &list,
+    int (*cmp)(const void *, const void *))
+{
+    list.sort(fp_less{cmp});
+}
+
+__attribute__((noinline)) static void sort_inline(item_list &list)
+{
+    list.sort(item_less());
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(item_list &list, listitem *items, size_t n, unsigned seed)
+{
+    srand(seed);
+    INIT_LIST_HEAD(list.native());
+    for (size_t i = 0; i < n; i++) {
+        items[i].i = (uint16_t) rand();
+        list.push_back(&items[i]);
+    }
+}
+
+static bool is_sorted(item_list &list, size_t n)
+{
+    size_t count = 0;
+    uint16_t prev = 0;
+    for (listitem &item : list) {
+        if (item.i < prev)
+            return false;
+        prev = item.i;
+        count++;
+    }
+    return count == n;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 20;
+    int rounds = 5;
+    listitem *items = (listitem *) malloc(sizeof(listitem) * n);
+    assert(items);
+
+    item_list list;
+    double t_fp = 0, t_inline = 0;
+    for (int r = 0; r < rounds; r++) {
+        fill(list, items, n, r);
+        double t0 = now();
+        sort_fp(list, cmpint);
+        t_fp += now() - t0;
+        assert(is_sorted(list, n));
+
+        fill(list, items, n, r);
+        t0 = now();
+        sort_inline(list);
+        t_inline += now() - t0;
+        assert(is_sorted(list, n));
+    }
+
+    printf("n = %zu, %d rounds\n", n, rounds);
+    printf("function pointer: %8.2f ms/sort\n", t_fp * 1e3 / rounds);
+    printf("inlined template: %8.2f ms/sort\n", t_inline * 1e3 / rounds);
+    printf("speedup:          %8.2fx\n", t_fp / t_inline);
+
+    free(items);
+    return 0;
+}
@@ -0,0 +1,183 @@
+/* Header-only C++ intrusive list on top of struct list_head */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+#include "list.h"
+
+/**
+ * intrusive_list<T, &T::member> - typed view over a circular list_head list
+ *
+ * The class holds exactly one struct list_head and nothing else, so it is
+ * layout-compatible with a plain list head: a list built with the list.h
+ * macros can be wrapped with intrusive_list::from(&head) and vice versa
+ * native() hands the head back to C code.
+ *
+ * sort() takes the comparator as a template parameter. The comparator type
+ * is part of the instantiation, so the compiler sees the comparison body at
+ * the call site and inlines it into the merge loop instead of calling
+ * through a pointer the way qsort()/list_sort() style interfaces must.
+ */
+template <typename T, struct list_head T::*Member>
+class intrusive_list
+{
+public:
+    intrusive_list() { INIT_LIST_HEAD(&head_); }
+    intrusive_list(const intrusive_list &) = delete;
+    intrusive_list &operator=(const intrusive_list &) = delete;
+
+    /* Reinterpret an existing list.h head as a typed list. */
+    static intrusive_list &from(struct list_head *head)
+    {
+        return *reinterpret_cast<intrusive_list *>(head);
+    }
+
+    struct list_head *native() { return &head_; }
+
+    static T *entry(struct list_head *node)
+    {
+        return reinterpret_cast<T *>(reinterpret_cast<char *>(node) -
+                                     member_offset());
+    }
+
+    static struct list_head *node(T *item) { return &(item->*Member); }
+
+    bool empty() const { return list_empty(&head_); }
+
+    size_t size() const
+    {
+        size_t n = 0;
+        for (const struct list_head *p = head_.next; p != &head_; p = p->next)
+            n++;
+        return n;
+    }
+
+    void push_front(T *item) { list_add(node(item), &head_); }
+    void push_back(T *item) { list_add_tail(node(item), &head_); }
+    static void erase(T *item) { list_del(node(item)); }
+
+    T *front() { return entry(head_.next); }
+    T *back() { return entry(head_.prev); }
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T *;
+        using reference = T &;
+
+        explicit iterator(struct list_head *p) : p_(p) {}
+        T &operator*() const { return *entry(p_); }
+        T *operator->() const { return entry(p_); }
+        iterator &operator++()
+        {
+            p_ = p_->next;
+            return *this;
+        }
+        iterator &operator--()
+        {
+            p_ = p_->prev;
+            return *this;
+        }
+        bool operator==(const iterator &o) const { return p_ == o.p_; }
+        bool operator!=(const iterator &o) const { return p_ != o.p_; }
+
+    private:
+        struct list_head *p_;
+    };
+
+    iterator begin() { return iterator(head_.next); }
+    iterator end() { return iterator(&head_); }
+
+    /**
+     * sort() - stable bottom-up merge sort
+     * @less: strict weak ordering, called as less(const T &, const T &)
+     *
+     * Nodes are relinked in place; no element is copied or allocated. Bin i
+     * holds a sorted run of 2^i nodes, as in the classic list merge sort, so
+     * the work is O(n log n) with no recursion.
+     */
+    template <typename Less>
+    void sort(Less less = Less())
+    {
+        if (list_empty(&head_) || list_is_singular(&head_))
+            return;
+
+        struct list_head *bins[64] = {};
+        int max_bin = 0;
+
+        struct list_head *list = head_.next;
+        head_.prev->next = nullptr;
+        while (list) {
+            struct list_head *cur = list;
+            list = list->next;
+            cur->next = nullptr;
+
+            int i = 0;
+            for (; i < max_bin && bins[i]; i++) {
+                cur = merge(less, bins[i], cur);
+                bins[i] = nullptr;
+            }
+            bins[i] = cur;
+            if (i == max_bin)
+                max_bin++;
+        }
+
+        struct list_head *result = nullptr;
+        for (int i = 0; i < max_bin; i++) {
+            if (bins[i])
+                result = result ? merge(less, bins[i], result) : bins[i];
+        }
+
+        /* Restore the prev links and close the circle. */
+        struct list_head *prev = &head_;
+        head_.next = result;
+        for (struct list_head *p = result; p; p = p->next) {
+            p->prev = prev;
+            prev = p;
+        }
+        prev->next = &head_;
+        head_.prev = prev;
+    }
+
+private:
+    static std::ptrdiff_t member_offset()
+    {
+        /* offsetof() does not accept a pointer-to-member. */
+        alignas(T) static unsigned char probe[sizeof(T)];
+        T *t = reinterpret_cast<T *>(probe);
+        return reinterpret_cast<char *>(&(t->*Member)) -
+               reinterpret_cast<char *>(t);
+    }
+
+    /* Merge two null-terminated runs; @a holds the earlier elements. */
+    template <typename Less>
+    static struct list_head *merge(Less &less,
+                                   struct list_head *a,
+                                   struct list_head *b)
+    {
+        struct list_head dummy;
+        struct list_head *tail = &dummy;
+
+        while (a && b) {
+            if (less(*entry(b), *entry(a))) {
+                tail->next = b;
+                b = b->next;
+            } else {
+                tail->next = a;
+                a = a->next;
+            }
+            tail = tail->next;
+        }
+        tail->next = a ? a : b;
+        return dummy.next;
+    }
+
+    struct list_head head_;
+};
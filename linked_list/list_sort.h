@@ -0,0 +1,826 @@
+/* Sorts for lists of struct listitem shared by main2.c and sort_bench.c */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "list.h"
+#include "sort_count.h"
+#include "sort_network.h"
+#include "tpool.h"
+
+/* Partitions at or below this many nodes are sorted serially; the one
+ * default for list_quicksort_par() and main.c's merge_sort_par().
+ */
+#ifndef PAR_CUTOFF
+#define PAR_CUTOFF 2048
+#endif
+
+struct listitem {
+    uint16_t i;
+    struct list_head list;
+};
+
+static inline int cmpint(const void *p1, const void *p2)
+{
+    const uint16_t *i1 = (const uint16_t *) p1;
+    const uint16_t *i2 = (const uint16_t *) p2;
+
+    return *i1 - *i2;
+}
+
+/* Leaf size for list_quicksort(); benchmarks may lower it at run time. */
+static int sort_leaf_cutoff = SORT_LEAF_CUTOFF;
+
+/* Sort @head with a sorting network if it has at most sort_leaf_cutoff
+ * nodes. Returns false, leaving the list untouched, if it is larger.
+ *
+ * A leaf that is already in order, typically a run of one duplicated key
+ * split off by the partitioning, is left alone: the network would cost more
+ * than the predictable partitions it replaces.
+ */
+static inline bool list_sort_leaf(struct list_head *head)
+{
+    uint32_t keys[16];
+    struct list_head *nodes[16];
+    struct list_head *node;
+    int n = 0;
+    bool sorted = true;
+
+    list_for_each (node, head) {
+        if (n == sort_leaf_cutoff || n == 16)
+            return false;
+        keys[n] = (uint32_t) list_entry(node, struct listitem, list)->i << 16 |
+                  n;
+        sorted &= n == 0 || keys[n] >> 16 >= keys[n - 1] >> 16;
+        nodes[n++] = node;
+    }
+    if (sorted)
+        return true;
+
+    sort_network_u32(keys, n);
+
+    struct list_head *prev = head;
+    for (int i = 0; i < n; i++) {
+        node = nodes[keys[i] & 0xFFFF];
+        prev->next = node;
+        node->prev = prev;
+        prev = node;
+    }
+    prev->next = head;
+    head->prev = prev;
+    return true;
+}
+
+/* list_quicksort() on a list of @n nodes; the partitions count their own
+ * nodes, so the leaf check never has to walk a list that is too long.
+ */
+static inline void list_quicksort_n(struct list_head *head, size_t n)
+{
+    struct list_head list_less, list_greater;
+    struct listitem *pivot;
+    struct listitem *item = NULL, *is = NULL;
+    size_t n_less = 0;
+
+    if (n < 2)
+        return;
+    if (n <= (size_t) sort_leaf_cutoff && list_sort_leaf(head))
+        return;
+
+    SORT_COUNT_ENTER();
+    INIT_LIST_HEAD(&list_less);
+    INIT_LIST_HEAD(&list_greater);
+
+    pivot = list_first_entry(head, struct listitem, list);//AAAA
+    list_del(&pivot->list);                               //BBBB
+
+    list_for_each_entry_safe (item, is, head, list) {
+        SORT_COUNT_CMP();
+        SORT_COUNT_MOVE();
+        if (cmpint(&item->i, &pivot->i) < 0) {
+            list_move_tail(&item->list, &list_less);
+            n_less++;
+        } else {
+            list_move_tail(&item->list, &list_greater);  //CCCC
+        }
+    }
+
+    list_quicksort_n(&list_less, n_less);
+    list_quicksort_n(&list_greater, n - 1 - n_less);
+
+    list_add(&pivot->list, head);                        //DDDD
+    list_splice(&list_less, head);                       //EEEE
+    list_splice_tail(&list_greater, head);               //FFFF
+    SORT_COUNT_SPLICE();
+    SORT_COUNT_SPLICE();
+    SORT_COUNT_LEAVE();
+}
+
+static inline void list_quicksort(struct list_head *head)
+{
+    struct list_head *node;
+    size_t n = 0;
+
+    list_for_each (node, head)
+        n++;
+    list_quicksort_n(head, n);
+}
+
+/* Median of the first, middle and last key of a list of @n >= 2 nodes. */
+static inline uint16_t list_3way_pivot(struct list_head *head, size_t n)
+{
+    struct list_head *mid = head->next;
+    for (size_t i = 0; i < n / 2; i++)
+        mid = mid->next;
+
+    uint16_t a = list_entry(head->next, struct listitem, list)->i;
+    uint16_t b = list_entry(mid, struct listitem, list)->i;
+    uint16_t c = list_entry(head->prev, struct listitem, list)->i;
+    return a < b ? (b < c ? b : (a < c ? c : a))
+                 : (a < c ? a : (b < c ? c : b));
+}
+
+/* list_quicksort_3way() on a list of @n nodes. Finished keys collect in
+ * @front and @back around the part still being sorted: the smaller of the
+ * less and greater partitions is sorted by recursion and moved out, the
+ * larger one is sorted by the next iteration, so the stack holds at most
+ * log2(n) frames whatever the pivots turn out to be.
+ */
+static inline void list_quicksort_3way_n(struct list_head *head, size_t n)
+{
+    struct list_head front, back;
+    struct list_head list_less, list_equal, list_greater;
+    struct listitem *item = NULL, *is = NULL;
+
+    SORT_COUNT_ENTER();
+    INIT_LIST_HEAD(&front);
+    INIT_LIST_HEAD(&back);
+    while (n > 1 && !(n <= (size_t) sort_leaf_cutoff && list_sort_leaf(head))) {
+        uint16_t pivot = list_3way_pivot(head, n);
+        size_t n_less = 0, n_greater = 0;
+
+        INIT_LIST_HEAD(&list_less);
+        INIT_LIST_HEAD(&list_equal);
+        INIT_LIST_HEAD(&list_greater);
+        list_for_each_entry_safe (item, is, head, list) {
+            SORT_COUNT_CMP();
+            SORT_COUNT_MOVE();
+            if (item->i < pivot) {
+                list_move_tail(&item->list, &list_less);
+                n_less++;
+            } else if (item->i > pivot) {
+                list_move_tail(&item->list, &list_greater);
+                n_greater++;
+            } else {
+                list_move_tail(&item->list, &list_equal);
+            }
+        }
+
+        if (n_less < n_greater) {
+            list_quicksort_3way_n(&list_less, n_less);
+            list_splice_tail(&list_less, &front);
+            list_splice_tail(&list_equal, &front);
+            list_splice(&list_greater, head);
+            n = n_greater;
+        } else {
+            list_quicksort_3way_n(&list_greater, n_greater);
+            list_splice(&list_greater, &back);
+            list_splice(&list_equal, &back);
+            list_splice(&list_less, head);
+            n = n_less;
+        }
+        SORT_COUNT_SPLICE();
+        SORT_COUNT_SPLICE();
+        SORT_COUNT_SPLICE();
+    }
+    list_splice(&front, head);
+    list_splice_tail(&back, head);
+    SORT_COUNT_SPLICE();
+    SORT_COUNT_SPLICE();
+    SORT_COUNT_LEAVE();
+}
+
+struct qsort_job {
+    struct list_head *head;
+    size_t n, cutoff;
+};
+
+/* Partitions list_quicksort_par() hands out per call before it sorts the
+ * rest itself; only pivots far off the median ever use them all.
+ */
+#define QSORT_PAR_SPAWNS 64
+
+static inline void list_quicksort_par(struct list_head *head,
+                                      size_t n,
+                                      size_t cutoff);
+
+static inline void list_quicksort_job(void *arg)
+{
+    struct qsort_job *job = arg;
+    list_quicksort_par(job->head, job->n, job->cutoff);
+}
+
+/* Parallel mode of list_quicksort_3way(), run inside tpool_run(). Each
+ * round partitions around the same median of three, spawns the smaller of
+ * the less and greater sides as a stealable task and keeps going on the
+ * larger one, so every task is at most half its parent and nesting stays
+ * at log2(n). Below @cutoff nodes the rest is sorted serially. The sides
+ * are spliced back in order once all tasks have synced.
+ */
+static inline void list_quicksort_par(struct list_head *head,
+                                      size_t n,
+                                      size_t cutoff)
+{
+    struct {
+        task_t task;
+        struct qsort_job job;
+        struct list_head side, equal;
+        bool less; /* @side holds keys below @equal, else above it */
+    } part[QSORT_PAR_SPAWNS];
+    struct list_head list_less, list_greater;
+    struct listitem *item = NULL, *is = NULL;
+    int parts = 0;
+
+    SORT_COUNT_ENTER();
+    while (n > cutoff && n > 1 && parts < QSORT_PAR_SPAWNS) {
+        uint16_t pivot = list_3way_pivot(head, n);
+        size_t n_less = 0, n_greater = 0;
+
+        INIT_LIST_HEAD(&list_less);
+        INIT_LIST_HEAD(&list_greater);
+        INIT_LIST_HEAD(&part[parts].equal);
+        list_for_each_entry_safe (item, is, head, list) {
+            SORT_COUNT_CMP();
+            SORT_COUNT_MOVE();
+            if (item->i < pivot) {
+                list_move_tail(&item->list, &list_less);
+                n_less++;
+            } else if (item->i > pivot) {
+                list_move_tail(&item->list, &list_greater);
+                n_greater++;
+            } else {
+                list_move_tail(&item->list, &part[parts].equal);
+            }
+        }
+
+        part[parts].less = n_less < n_greater;
+        INIT_LIST_HEAD(&part[parts].side);
+        list_splice(part[parts].less ? &list_less : &list_greater,
+                    &part[parts].side);
+        list_splice(part[parts].less ? &list_greater : &list_less, head);
+        SORT_COUNT_SPLICE();
+        SORT_COUNT_SPLICE();
+        part[parts].job = (struct qsort_job){
+            &part[parts].side, part[parts].less ? n_less : n_greater, cutoff};
+        n = part[parts].less ? n_greater : n_less;
+        tpool_spawn(&part[parts].task, list_quicksort_job, &part[parts].job);
+        parts++;
+    }
+    list_quicksort_3way_n(head, n);
+
+    while (parts--) {
+        tpool_sync(&part[parts].task);
+        if (part[parts].less) {
+            list_splice(&part[parts].equal, head);
+            list_splice(&part[parts].side, head);
+        } else {
+            list_splice_tail(&part[parts].equal, head);
+            list_splice_tail(&part[parts].side, head);
+        }
+        SORT_COUNT_SPLICE();
+        SORT_COUNT_SPLICE();
+    }
+    SORT_COUNT_LEAVE();
+}
+
+static inline void array_sort_u64(uint64_t *v, size_t n)
+{
+    while (n > 16) {
+        uint64_t a = v[0], b = v[n / 2], c = v[n - 1];
+        uint64_t pivot = a < b ? (b < c ? b : (a < c ? c : a))
+                               : (a < c ? a : (b < c ? c : b));
+        size_t i = 0, j = n - 1;
+        for (;;) {
+            while (v[i] < pivot)
+                i++;
+            while (v[j] > pivot)
+                j--;
+            if (i >= j)
+                break;
+            uint64_t t = v[i];
+            v[i++] = v[j];
+            v[j--] = t;
+        }
+        /* Recurse into the smaller side to bound the stack depth. */
+        if (j + 1 < n - j - 1) {
+            array_sort_u64(v, j + 1);
+            v += j + 1;
+            n -= j + 1;
+        } else {
+            array_sort_u64(v + j + 1, n - j - 1);
+            n = j + 1;
+        }
+    }
+    for (size_t i = 1; i < n; i++) {
+        uint64_t x = v[i];
+        size_t j = i;
+        for (; j > 0 && v[j - 1] > x; j--)
+            v[j] = v[j - 1];
+        v[j] = x;
+    }
+}
+
+/**
+ * list_array_sort() - sort through a contiguous array of packed keys
+ *
+ * Keys are packed as key << 40 | position, sorted in a flat array where the
+ * comparisons hit sequential memory, and the nodes are then relinked in one
+ * pass. Falls back to list_quicksort() if the arrays cannot be allocated.
+ */
+static inline void list_array_sort(struct list_head *head, size_t n)
+{
+    uint64_t *keys = malloc(sizeof(uint64_t) * n);
+    struct list_head **nodes = malloc(sizeof(struct list_head *) * n);
+    if (!keys || !nodes || n >= (1ULL << 40)) {
+        free(keys);
+        free(nodes);
+        list_quicksort(head);
+        return;
+    }
+
+    size_t i = 0;
+    struct list_head *node;
+    list_for_each (node, head) {
+        keys[i] =
+            (uint64_t) list_entry(node, struct listitem, list)->i << 40 | i;
+        nodes[i++] = node;
+    }
+    array_sort_u64(keys, n);
+
+    struct list_head *prev = head;
+    for (i = 0; i < n; i++) {
+        node = nodes[keys[i] & ((1ULL << 40) - 1)];
+        prev->next = node;
+        node->prev = prev;
+        prev = node;
+    }
+    prev->next = head;
+    head->prev = prev;
+
+    free(keys);
+    free(nodes);
+}
+
+/* Buckets per thread in list_sample_sort(); more buckets balance better. */
+#ifndef SAMPLE_BUCKETS_PER_THREAD
+#define SAMPLE_BUCKETS_PER_THREAD 4
+#endif
+#define SAMPLE_OVERSAMPLE 16
+
+struct sample_sort {
+    struct list_head *head;
+    size_t n;
+    int nthreads, nsplitters, nbuckets;
+    uint16_t *splitters;          /* nsplitters distinct keys, ascending */
+    struct list_head *segments;   /* nthreads input segments */
+    struct list_head *buckets;    /* nthreads x nbuckets local buckets */
+};
+
+struct sample_job {
+    struct sample_sort *ss;
+    int id;
+};
+
+/* The bucket @key belongs to: with s the number of splitters below @key,
+ * 2s + 1 if @key equals the next splitter, else 2s. Odd buckets hold a
+ * single key value and need no sorting.
+ */
+static inline int sample_bucket(const uint16_t *splitters,
+                                int n,
+                                uint16_t key)
+{
+    int lo = 0, end = n;
+    while (n > 0) {
+        int half = n / 2;
+        if (splitters[lo + half] < key) {
+            lo += half + 1;
+            n -= half + 1;
+        } else {
+            n = half;
+        }
+    }
+    return 2 * lo + (lo < end && splitters[lo] == key);
+}
+
+static inline void sample_partition_job(void *arg)
+{
+    struct sample_job *job = arg;
+    struct sample_sort *ss = job->ss;
+    struct list_head *local = &ss->buckets[job->id * ss->nbuckets];
+    struct listitem *item, *is;
+
+    list_for_each_entry_safe (item, is, &ss->segments[job->id], list) {
+        int b = sample_bucket(ss->splitters, ss->nsplitters, item->i);
+        list_move_tail(&item->list, &local[b]);
+    }
+}
+
+static inline void sample_bucket_job(void *arg)
+{
+    struct sample_job *job = arg;
+    struct list_head *bucket = &job->ss->buckets[job->id], *node;
+    size_t n = 0;
+
+    list_for_each (node, bucket)
+        n++;
+    if (n > 1)
+        list_array_sort(bucket, n);
+}
+
+static inline void sample_sort_root(void *arg)
+{
+    struct sample_sort *ss = arg;
+    int nthreads = ss->nthreads, nbuckets = ss->nbuckets;
+    int nsplit = nthreads * SAMPLE_BUCKETS_PER_THREAD - 1;
+    size_t seg_len = ss->n / nthreads;
+    size_t nsample = (size_t) (nsplit + 1) * SAMPLE_OVERSAMPLE;
+    if (nsample > ss->n)
+        nsample = ss->n;
+    size_t stride = ss->n / nsample;
+    uint16_t *sample = malloc(sizeof(uint16_t) * nsample);
+    struct list_head *bounds[nthreads];
+    struct sample_job jobs[nbuckets];
+    task_t tasks[nbuckets];
+
+    /* One read-only walk records the segment boundaries and draws one
+     * random key from every stride-sized window.
+     */
+    size_t idx = 0, s = 0, pick = rand() % stride;
+    int seg = 0;
+    struct list_head *node;
+    list_for_each (node, ss->head) {
+        if (seg < nthreads - 1 && idx == seg_len * (seg + 1))
+            bounds[seg++] = node->prev;
+        if (s < nsample && idx == s * stride + pick) {
+            sample[s++] = list_entry(node, struct listitem, list)->i;
+            pick = rand() % stride;
+        }
+        idx++;
+    }
+    /* Equal splitters collapse into one, so a key frequent enough to be
+     * drawn several times gets its own equality bucket instead of one
+     * oversized bucket to sort.
+     */
+    qsort(sample, s, sizeof(uint16_t), cmpint);
+    ss->nsplitters = 0;
+    for (int b = 1; b <= nsplit; b++) {
+        uint16_t key = sample[(size_t) b * s / (nsplit + 1)];
+        if (!ss->nsplitters || ss->splitters[ss->nsplitters - 1] != key)
+            ss->splitters[ss->nsplitters++] = key;
+    }
+    free(sample);
+
+    /* Detach the segments so threads never share a boundary node. */
+    for (int t = 0; t < nthreads - 1; t++)
+        list_cut_position(&ss->segments[t], ss->head, bounds[t]);
+    list_splice_init(ss->head, &ss->segments[nthreads - 1]);
+
+    for (int t = 0; t < nthreads; t++) {
+        jobs[t] = (struct sample_job){ss, t};
+        tpool_spawn(&tasks[t], sample_partition_job, &jobs[t]);
+    }
+    for (int t = nthreads - 1; t >= 0; t--)
+        tpool_sync(&tasks[t]);
+
+    /* Join matching buckets of every thread into the first thread's row. */
+    for (int b = 0; b < nbuckets; b++)
+        for (int t = 1; t < nthreads; t++)
+            list_splice_tail(&ss->buckets[t * nbuckets + b], &ss->buckets[b]);
+
+    for (int b = 0; b < nbuckets; b += 2) {
+        jobs[b] = (struct sample_job){ss, b};
+        tpool_spawn(&tasks[b], sample_bucket_job, &jobs[b]);
+    }
+    for (int b = (nbuckets - 1) & ~1; b >= 0; b -= 2)
+        tpool_sync(&tasks[b]);
+
+    for (int b = 0; b < nbuckets; b++)
+        list_splice_tail(&ss->buckets[b], ss->head);
+}
+
+/**
+ * list_sample_sort() - parallel sample sort of a list of struct listitem
+ * @head: list to sort
+ * @pool: worker pool; its thread count sets the number of segments
+ *
+ * Splitters come from a random sample of the keys. Each worker then moves
+ * the nodes of its own segment into private bucket lists, so no single
+ * thread has to partition the whole list. Matching buckets are joined with
+ * list_splice_tail() and sorted independently by list_array_sort(), which
+ * stays O(n log n) on sorted runs and duplicates; the buckets of keys equal
+ * to a splitter are already sorted and skipped.
+ */
+static inline void list_sample_sort(struct list_head *head, struct tpool *pool)
+{
+    size_t n = 0;
+    struct list_head *node;
+    list_for_each (node, head)
+        n++;
+
+    int nthreads = pool->nthreads;
+    if (n < (size_t) nthreads * SAMPLE_BUCKETS_PER_THREAD * SAMPLE_OVERSAMPLE) {
+        if (n > 1)
+            list_array_sort(head, n);
+        return;
+    }
+
+    /* Up to nthreads * SAMPLE_BUCKETS_PER_THREAD - 1 splitters, each with
+     * an equality bucket between the range buckets on either side.
+     */
+    struct sample_sort ss = {
+        .head = head,
+        .n = n,
+        .nthreads = nthreads,
+        .nbuckets = 2 * nthreads * SAMPLE_BUCKETS_PER_THREAD - 1,
+    };
+    ss.splitters = malloc(sizeof(uint16_t) * ss.nbuckets);
+    ss.segments = malloc(sizeof(struct list_head) * nthreads);
+    ss.buckets = malloc(sizeof(struct list_head) * nthreads * ss.nbuckets);
+    for (int t = 0; t < nthreads; t++)
+        INIT_LIST_HEAD(&ss.segments[t]);
+    for (int b = 0; b < nthreads * ss.nbuckets; b++)
+        INIT_LIST_HEAD(&ss.buckets[b]);
+
+    tpool_run(pool, sample_sort_root, &ss);
+
+    free(ss.splitters);
+    free(ss.segments);
+    free(ss.buckets);
+}
+
+/* Strategies list_adaptive_sort() can dispatch to. */
+enum list_sort_path {
+    LIST_SORT_QUICK, /* tiny input: list_quicksort() */
+    LIST_SORT_MERGE, /* presorted: natural merge of existing runs */
+    LIST_SORT_RADIX, /* narrow key range: one LSD pass over list buckets */
+    LIST_SORT_3WAY,  /* duplicate-heavy: three-way quicksort */
+    LIST_SORT_ARRAY, /* large random: sort an array of keys, then relink */
+};
+
+struct list_sort_stats {
+    enum list_sort_path path;
+    size_t n;
+    size_t runs;            /* ascending runs in the whole list */
+    double inversion_ratio; /* inverted pairs / all pairs, in the sample */
+    double dup_ratio;       /* equal neighbours in the sorted sample */
+    unsigned span;          /* max key - min key */
+    uint64_t choose_ns;     /* time spent profiling and choosing */
+    uint64_t sort_ns;       /* time spent in the chosen sort */
+};
+
+static inline const char *list_sort_path_name(enum list_sort_path path)
+{
+    static const char *names[] = {"quick", "merge", "radix", "3way", "array"};
+    return names[path];
+}
+
+#define LIST_SORT_SAMPLE 256
+
+static inline uint64_t list_sort_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Merge two NULL-terminated runs; @a holds the earlier (stable) elements. */
+static inline struct list_head *list_merge_runs(struct list_head *a,
+                                                struct list_head *b)
+{
+    struct list_head dummy;
+    struct list_head *tail = &dummy;
+
+    while (a && b) {
+        if (list_entry(b, struct listitem, list)->i <
+            list_entry(a, struct listitem, list)->i) {
+            tail->next = b;
+            b = b->next;
+        } else {
+            tail->next = a;
+            a = a->next;
+        }
+        tail = tail->next;
+    }
+    tail->next = a ? a : b;
+    return dummy.next;
+}
+
+/* Restore prev links on a NULL-terminated chain and close it at @head. */
+static inline void list_relink(struct list_head *head, struct list_head *first)
+{
+    struct list_head *prev = head;
+    head->next = first;
+    for (struct list_head *p = first; p; p = p->next) {
+        p->prev = prev;
+        prev = p;
+    }
+    prev->next = head;
+    head->prev = prev;
+}
+
+/**
+ * list_natural_merge_sort() - stable merge sort over the existing runs
+ *
+ * Maximal ascending runs are the leaves of a bottom-up merge, so an input
+ * made of r runs costs O(n log r); a sorted list is a single O(n) scan.
+ */
+static inline void list_natural_merge_sort(struct list_head *head)
+{
+    struct list_head *bins[64] = {NULL};
+    int max_bin = 0;
+
+    if (list_empty(head) || list_is_singular(head))
+        return;
+
+    struct list_head *list = head->next;
+    head->prev->next = NULL;
+    while (list) {
+        struct list_head *run = list, *tail = list;
+        while (tail->next && list_entry(tail->next, struct listitem, list)->i >=
+                                 list_entry(tail, struct listitem, list)->i)
+            tail = tail->next;
+        list = tail->next;
+        tail->next = NULL;
+
+        int i = 0;
+        for (; i < max_bin && bins[i]; i++) {
+            run = list_merge_runs(bins[i], run);
+            bins[i] = NULL;
+        }
+        bins[i] = run;
+        if (i == max_bin)
+            max_bin++;
+    }
+
+    struct list_head *result = NULL;
+    for (int i = 0; i < max_bin; i++) {
+        if (bins[i])
+            result = result ? list_merge_runs(bins[i], result) : bins[i];
+    }
+    list_relink(head, result);
+}
+
+/**
+ * list_radix_sort() - stable LSD radix sort on (key - @min)
+ *
+ * Every pass distributes the nodes over 256 bucket lists and joins them back
+ * with list_splice_tail(); a span below 256 needs a single pass.
+ */
+static inline void list_radix_sort(struct list_head *head,
+                                   uint16_t min,
+                                   unsigned span)
+{
+    struct list_head buckets[256];
+    struct listitem *item, *is;
+
+    for (int shift = 0; shift == 0 || (span >> shift); shift += 8) {
+        for (int b = 0; b < 256; b++)
+            INIT_LIST_HEAD(&buckets[b]);
+        list_for_each_entry_safe (item, is, head, list) {
+            unsigned b = ((unsigned) (item->i - min) >> shift) & 0xFF;
+            list_move_tail(&item->list, &buckets[b]);
+        }
+        for (int b = 0; b < 256; b++)
+            list_splice_tail(&buckets[b], head);
+    }
+}
+
+/**
+ * list_quicksort_3way() - quicksort with a separate list for pivot equals
+ *
+ * Equal keys are finished after one partition instead of being re-sorted at
+ * every level, which keeps duplicate-heavy inputs at O(n log d) for d
+ * distinct keys. The pivot is the median of the first, middle and last key,
+ * which splits sorted and reversed runs in half.
+ */
+static inline void list_quicksort_3way(struct list_head *head)
+{
+    struct list_head *node;
+    size_t n = 0;
+
+    list_for_each (node, head)
+        n++;
+    list_quicksort_3way_n(head, n);
+}
+
+/**
+ * list_sort_profile() - one read-only walk over the list
+ *
+ * Counts nodes and ascending runs, tracks the key range, and keeps an
+ * order-preserving sample: when the sample buffer fills up every other key
+ * is dropped and the stride doubles, so it stays evenly spread.
+ */
+static inline void list_sort_profile(struct list_head *head,
+                                     struct list_sort_stats *st,
+                                     uint16_t *min_key)
+{
+    uint16_t sample[LIST_SORT_SAMPLE];
+    size_t ns = 0, stride = 1, n = 0, runs = 0;
+    uint16_t lo = UINT16_MAX, hi = 0, prev = 0;
+    struct listitem *item;
+
+    list_for_each_entry (item, head, list) {
+        uint16_t k = item->i;
+        if (n == 0 || k < prev)
+            runs++;
+        prev = k;
+        lo = k < lo ? k : lo;
+        hi = k > hi ? k : hi;
+        if (n % stride == 0) {
+            if (ns == LIST_SORT_SAMPLE) {
+                for (size_t j = 0; j < ns / 2; j++)
+                    sample[j] = sample[2 * j];
+                ns /= 2;
+                stride *= 2;
+            }
+            if (n % stride == 0)
+                sample[ns++] = k;
+        }
+        n++;
+    }
+
+    size_t inversions = 0;
+    for (size_t i = 0; i < ns; i++)
+        for (size_t j = i + 1; j < ns; j++)
+            inversions += sample[i] > sample[j];
+
+    qsort(sample, ns, sizeof(uint16_t), cmpint);
+    size_t dups = 0;
+    for (size_t i = 1; i < ns; i++)
+        dups += sample[i] == sample[i - 1];
+
+    st->n = n;
+    st->runs = runs;
+    st->inversion_ratio = ns > 1 ? 2.0 * inversions / (ns * (ns - 1)) : 0;
+    st->dup_ratio = ns > 1 ? (double) dups / (ns - 1) : 0;
+    st->span = n ? hi - lo : 0;
+    *min_key = lo;
+}
+
+/**
+ * list_adaptive_sort() - profile the list and dispatch to a suitable sort
+ * @head: list of struct listitem
+ * @stats: if not NULL, receives the profile, chosen path and timings
+ *
+ * Rules, in order: tiny lists use list_quicksort(); few runs or a nearly
+ * sorted sample take the natural merge; a key span below 256 takes a single
+ * radix pass; many duplicates take the three-way quicksort; everything else
+ * goes through the array-assisted path.
+ */
+static inline void list_adaptive_sort(struct list_head *head,
+                                      struct list_sort_stats *stats)
+{
+    struct list_sort_stats st;
+    uint16_t min_key;
+    uint64_t t0 = list_sort_now_ns();
+
+    list_sort_profile(head, &st, &min_key);
+    if (st.n <= 64)
+        st.path = LIST_SORT_QUICK;
+    else if (st.runs <= st.n / 64 || st.inversion_ratio < 0.02)
+        st.path = LIST_SORT_MERGE;
+    else if (st.span < 256)
+        st.path = LIST_SORT_RADIX;
+    else if (st.dup_ratio > 0.25)
+        st.path = LIST_SORT_3WAY;
+    else
+        st.path = LIST_SORT_ARRAY;
+
+    uint64_t t1 = list_sort_now_ns();
+    switch (st.path) {
+    case LIST_SORT_QUICK:
+        list_quicksort(head);
+        break;
+    case LIST_SORT_MERGE:
+        list_natural_merge_sort(head);
+        break;
+    case LIST_SORT_RADIX:
+        list_radix_sort(head, min_key, st.span);
+        break;
+    case LIST_SORT_3WAY:
+        list_quicksort_3way_n(head, st.n);
+        break;
+    case LIST_SORT_ARRAY:
+        list_array_sort(head, st.n);
+        break;
+    }
+    uint64_t t2 = list_sort_now_ns();
+
+    st.choose_ns = t1 - t0;
+    st.sort_ns = t2 - t1;
+    if (stats)
+        *stats = st;
+}
@@ -3,6 +3,9 @@
 #include <stdlib.h>
 #include <time.h>
 #include "list.h"
+#include "list_sort.h"
+#include "perf.h"
+#include "tpool.h"
 
 typedef struct list_item {
     int value;
@@ -161,6 +164,43 @@ static inline list_item_t *merge_sort(list_item_t *head) {
     return merge(left, right);
 }
 
+struct msort_job {
+    list_item_t *head, *result;
+    size_t n, cutoff;
+};
+
+static void merge_sort_job(void *arg);
+
+/* Parallel mode of merge_sort(), run inside tpool_run(). The left half is
+ * spawned as a stealable task while this worker sorts the right half.
+ */
+static list_item_t *merge_sort_par(list_item_t *head, size_t n, size_t cutoff)
+{
+    if (n <= cutoff)
+        return merge_sort(head);
+
+    size_t n_left = n / 2;
+    list_item_t *middle = head;
+    for (size_t i = 1; i < n_left; i++)
+        middle = middle->next;
+    list_item_t *next_to_middle = middle->next;
+    middle->next = NULL;
+
+    task_t task;
+    struct msort_job left = {head, NULL, n_left, cutoff};
+    tpool_spawn(&task, merge_sort_job, &left);
+    list_item_t *right = merge_sort_par(next_to_middle, n - n_left, cutoff);
+    tpool_sync(&task);
+
+    return merge(left.result, right);
+}
+
+static void merge_sort_job(void *arg)
+{
+    struct msort_job *job = arg;
+    job->result = merge_sort_par(job->head, job->n, job->cutoff);
+}
+
 static inline void print_list(list_t *l){
     list_item_t *cur = l->head->next;
     while(cur){
@@ -191,7 +231,11 @@ int main(void)
     
     // Start sorting the list
     cur = l.head->next;
+    PERF_REGION(sort_region, "merge_sort");
+    PERF_BEGIN(sort_region);
     list_item_t *merge_result = merge_sort(cur);
+    PERF_END(sort_region);
+    PERF_REPORT(sort_region);
     l.head->next = merge_result;
     
     // Check if the result correct
@@ -206,5 +250,39 @@ int main(void)
     	cur = cur->next;
     }
     printf("The result is correct!\n");
+
+    printf("===========TEST Parallel Merge Sort===========\n");
+    /* Sublists at or below PAR_CUTOFF items are sorted serially, so the
+     * test list is a few times that long for the pool to actually fork.
+     */
+    size_t par_n = 4 * PAR_CUTOFF;
+    list_item_t *par_items = malloc(sizeof(list_item_t) * par_n);
+    struct tpool *pool = tpool_create(0);
+    if (!par_items || !pool) {
+        printf("Parallel test setup failed\n");
+        return 0;
+    }
+    for (size_t i = 0; i < par_n; i++) {
+        par_items[i].value = rand();
+        par_items[i].next = i + 1 < par_n ? &par_items[i + 1] : NULL;
+    }
+    struct msort_job job = {par_items, NULL, par_n, PAR_CUTOFF};
+    tpool_run(pool, merge_sort_job, &job);
+    tpool_print_stats(pool, "merge_sort_par");
+    tpool_destroy(pool);
+
+    size_t seen = 0;
+    prev_int = 0;
+    for (cur = job.result; cur; cur = cur->next, seen++) {
+        if (prev_int > cur->value)
+            break;
+        prev_int = cur->value;
+    }
+    free(par_items);
+    if (cur || seen != par_n) {
+        printf("The result is wrong!\n");
+        return 0;
+    }
+    printf("The result is correct!\n");
     return 0;
 }
@@ -1,5 +1,7 @@
 #include <stdint.h>
 #include "list.h"
+#include "list_sort.h"
+#include "perf.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -7,18 +9,6 @@
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
 
 static uint16_t values[256];
-struct listitem {
-    uint16_t i;
-    struct list_head list;
-};
-
-static inline int cmpint(const void *p1, const void *p2)
-{
-    const uint16_t *i1 = (const uint16_t *) p1;
-    const uint16_t *i2 = (const uint16_t *) p2;
-
-    return *i1 - *i2;
-}
 
 static inline uint8_t getnum(void)
 {
@@ -61,37 +51,6 @@ static inline void random_shuffle_array(uint16_t *operations, uint16_t len)
     }
 }
 
-static void list_quicksort(struct list_head *head)
-{
-    struct list_head list_less, list_greater;
-    struct listitem *pivot;
-    struct listitem *item = NULL, *is = NULL;
-
-    if (list_empty(head) || list_is_singular(head))
-        return;
-
-    INIT_LIST_HEAD(&list_less);
-    INIT_LIST_HEAD(&list_greater);
-
-    pivot = list_first_entry(head, struct listitem, list);//AAAA
-    list_del(&pivot->list);                               //BBBB
-
-    list_for_each_entry_safe (item, is, head, list) {
-        if (cmpint(&item->i, &pivot->i) < 0)
-            list_move_tail(&item->list, &list_less);
-        else
-            list_move_tail(&item->list, &list_greater);  //CCCC
-    }
-
-    list_quicksort(&list_less);
-    list_quicksort(&list_greater);
-
-    list_add(&pivot->list, head);                        //DDDD
-    list_splice(&list_less, head);                       //EEEE
-    list_splice_tail(&list_greater, head);               //FFFF
-}
-
-
 int main(void)
 {
     struct list_head testlist;
@@ -114,7 +73,22 @@ int main(void)
     assert(!list_empty(&testlist));
 
     qsort(values, ARRAY_SIZE(values), sizeof(values[0]), cmpint);
+    PERF_REGION(sort_region, "list_quicksort");
+    SORT_COUNT_RESET();
+    PERF_BEGIN(sort_region);
     list_quicksort(&testlist);
+    PERF_END(sort_region);
+    PERF_REPORT(sort_region);
+    SORT_COUNT_REPORT("list_quicksort (random)");
+
+#ifdef SORT_COUNT
+    /* Sorting the sorted list again is the first-element pivot worst case:
+     * the counters show quadratic comparisons and linear recursion depth.
+     */
+    SORT_COUNT_RESET();
+    list_quicksort(&testlist);
+    SORT_COUNT_REPORT("list_quicksort (sorted)");
+#endif
 
     i = 0;
     list_for_each_entry_safe (item, is, &testlist, list) {
@@ -129,6 +103,35 @@ int main(void)
 
     printf("%d\n", getnum());
     printf("%d\n", getnum());
+
+    /* Parallel mode, on a few times PAR_CUTOFF nodes so the pool forks. */
+    struct tpool *pool = tpool_create(0);
+    assert(pool);
+    size_t par_n = 4 * PAR_CUTOFF;
+    for (i = 0; i < par_n; i++) {
+        item = (struct listitem *) malloc(sizeof(*item));
+        assert(item);
+        item->i = get_unsigned16();
+        list_add_tail(&item->list, &testlist);
+    }
+
+    struct qsort_job job = {&testlist, par_n, PAR_CUTOFF};
+    SORT_COUNT_RESET();
+    tpool_run(pool, list_quicksort_job, &job);
+    tpool_print_stats(pool, "list_quicksort_par");
+    SORT_COUNT_REPORT("list_quicksort_par");
+
+    uint16_t prev = 0;
+    i = 0;
+    list_for_each_entry_safe (item, is, &testlist, list) {
+        assert(item->i >= prev);
+        prev = item->i;
+        list_del(&item->list);
+        free(item);
+        i++;
+    }
+    assert(i == par_n);
+    tpool_destroy(pool);
     return 0;
 }
 
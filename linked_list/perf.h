@@ -0,0 +1,193 @@
+/* Scoped hardware performance counter regions built on perf_event_open */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Usage:
+ *
+ *   PERF_REGION(sort_region, "list_quicksort");
+ *   PERF_BEGIN(sort_region);
+ *   list_quicksort(&testlist);
+ *   PERF_END(sort_region);
+ *   PERF_REPORT(sort_region);
+ *
+ * The macros expand to nothing unless the program is built with -DPERF, so
+ * the instrumented code paths cost nothing in normal builds. Each region
+ * accumulates counter deltas over every BEGIN/END pair and PERF_REPORT()
+ * prints one summary line per region to stderr.
+ *
+ * Counters are opened once per process for the calling thread, as a single
+ * event group read with PERF_FORMAT_GROUP, so BEGIN and END cost one read()
+ * each. That is still a syscall on each side: put the region around a loop
+ * of calls, not around one map lookup or tree insert, or it measures the
+ * syscall. If the PMU is not accessible (perf_event_paranoid, containers,
+ * VMs without vPMU) the affected events are reported as "n/a" and only the
+ * rdtsc count is kept.
+ */
+
+enum perf_event_id {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_NR_EVENTS,
+};
+
+struct perf_region {
+    const char *name;
+    uint64_t calls;
+    uint64_t tsc, tsc_start;
+    uint64_t count[PERF_NR_EVENTS];
+    uint64_t start[PERF_NR_EVENTS];
+};
+
+/* Group leader fd, and each event's index in the group's read or -1. */
+static int perf_group_fd = -2;
+static int perf_slot[PERF_NR_EVENTS];
+static int perf_nr_slots;
+
+static inline uint64_t perf_rdtsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static inline int perf_open_event(uint32_t type, uint64_t config, int group)
+{
+#if defined(__linux__)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+#else
+    (void) type, (void) config, (void) group;
+    return -1;
+#endif
+}
+
+static inline void perf_init(void)
+{
+    if (perf_group_fd != -2)
+        return;
+    perf_group_fd = -1;
+
+#if defined(__linux__)
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[PERF_NR_EVENTS] = {
+        [PERF_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        [PERF_INSTRUCTIONS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        [PERF_L1D_MISSES] = {PERF_TYPE_HW_CACHE,
+                             PERF_COUNT_HW_CACHE_L1D |
+                                 (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        [PERF_LLC_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        [PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE,
+                                PERF_COUNT_HW_BRANCH_MISSES},
+    };
+
+    /* The first event that opens leads the group; the rest join it in
+     * order, which is the order a group read returns them in.
+     */
+    for (int i = 0; i < PERF_NR_EVENTS; i++) {
+        int fd = perf_open_event(events[i].type, events[i].config,
+                                 perf_group_fd);
+        perf_slot[i] = fd < 0 ? -1 : perf_nr_slots++;
+        if (fd >= 0 && perf_group_fd < 0)
+            perf_group_fd = fd;
+    }
+#else
+    for (int i = 0; i < PERF_NR_EVENTS; i++)
+        perf_slot[i] = -1;
+#endif
+}
+
+/* All counters of the group into @val, by event; zeros if unavailable. */
+static inline void perf_read(uint64_t val[PERF_NR_EVENTS])
+{
+    uint64_t buf[1 + PERF_NR_EVENTS] = {0}; /* nr, then the values */
+    ssize_t want = (ssize_t) (sizeof(uint64_t) * (1 + perf_nr_slots));
+
+    if (perf_group_fd < 0 || read(perf_group_fd, buf, want) != want)
+        memset(buf, 0, sizeof(buf));
+    for (int i = 0; i < PERF_NR_EVENTS; i++)
+        val[i] = perf_slot[i] < 0 ? 0 : buf[1 + perf_slot[i]];
+}
+
+static inline void perf_begin(struct perf_region *r)
+{
+    perf_init();
+    perf_read(r->start);
+    r->tsc_start = perf_rdtsc();
+}
+
+static inline void perf_end(struct perf_region *r)
+{
+    uint64_t tsc = perf_rdtsc(), now[PERF_NR_EVENTS];
+    perf_read(now);
+    for (int i = 0; i < PERF_NR_EVENTS; i++)
+        r->count[i] += now[i] - r->start[i];
+    r->tsc += tsc - r->tsc_start;
+    r->calls++;
+}
+
+static inline void perf_report(const struct perf_region *r)
+{
+    static const char *names[PERF_NR_EVENTS] = {
+        "cycles", "instructions", "L1d-misses", "LLC-misses", "branch-misses",
+    };
+
+    fprintf(stderr, "[perf] %s: calls=%lu tsc=%lu", r->name,
+            (unsigned long) r->calls, (unsigned long) r->tsc);
+    for (int i = 0; i < PERF_NR_EVENTS; i++) {
+        if (perf_slot[i] < 0)
+            fprintf(stderr, " %s=n/a", names[i]);
+        else
+            fprintf(stderr, " %s=%lu", names[i], (unsigned long) r->count[i]);
+    }
+    if (perf_slot[PERF_CYCLES] >= 0 && r->count[PERF_CYCLES])
+        fprintf(stderr, " IPC=%.2f",
+                (double) r->count[PERF_INSTRUCTIONS] / r->count[PERF_CYCLES]);
+    fprintf(stderr, "\n");
+}
+
+#ifdef PERF
+#define PERF_REGION(var, region_name) \
+    static struct perf_region var = {.name = region_name}
+#define PERF_BEGIN(var) perf_begin(&(var))
+#define PERF_END(var) perf_end(&(var))
+#define PERF_REPORT(var) perf_report(&(var))
+#else
+#define PERF_REGION(var, region_name) \
+    static struct perf_region var __attribute__((unused))
+#define PERF_BEGIN(var) ((void) 0)
+#define PERF_END(var) ((void) 0)
+#define PERF_REPORT(var) ((void) 0)
+#endif
@@ -0,0 +1,217 @@
+/* Benchmark the list_head sorts in list_sort.h
+ *
+ * Build: gcc -O2 -pthread -o sort_bench sort_bench.c
+ * Usage: ./sort_bench [nodes] [max_threads]
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "list.h"
+#include "list_sort.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Fill with random keys; @unique > 0 limits them to that many values. */
+static void fill(struct list_head *head,
+                 struct listitem *items,
+                 size_t n,
+                 int unique)
+{
+    srand(42);
+    INIT_LIST_HEAD(head);
+    for (size_t i = 0; i < n; i++) {
+        items[i].i = (uint16_t) (unique ? rand() % unique : rand());
+        list_add_tail(&items[i].list, head);
+    }
+}
+
+/* Input shapes for the adaptive dispatcher, indexed like shapes[] in main. */
+static void fill_shape(struct list_head *head,
+                       struct listitem *items,
+                       size_t n,
+                       int shape)
+{
+    fill(head, items, n, shape == 3 ? 4096 : shape == 4 ? 200 : 0);
+    if (shape == 0 || shape == 3 || shape == 4)
+        return;
+
+    for (size_t i = 0; i < n; i++)
+        items[i].i = (uint16_t) (i * 65536 / n);
+    if (shape == 2) {
+        for (size_t i = 0; i < n / 100; i++) {
+            size_t a = rand() % n, b = rand() % n;
+            uint16_t t = items[a].i;
+            items[a].i = items[b].i;
+            items[b].i = t;
+        }
+    } else if (shape == 5) {
+        for (size_t i = 0; i < n; i++)
+            items[i].i = (uint16_t) (65535 - items[i].i);
+    } else if (shape == 6) {
+        /* Half the keys, at random places, are one hot value; the rest
+         * still ascend.
+         */
+        for (size_t i = 0; i < n; i++)
+            if (rand() & 1)
+                items[i].i = 30000;
+    }
+}
+
+static void check_sorted(struct list_head *head, size_t n)
+{
+    struct listitem *item;
+    size_t count = 0;
+    uint16_t prev = 0;
+    list_for_each_entry (item, head, list) {
+        assert(item->i >= prev);
+        prev = item->i;
+        count++;
+    }
+    assert(count == n);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 20;
+    int max_threads = argc > 2 ? atoi(argv[2])
+                               : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_threads < 1)
+        max_threads = 1;
+
+    struct listitem *items = malloc(sizeof(struct listitem) * n);
+    assert(items);
+    struct list_head head;
+
+    fill(&head, items, n, 0);
+    double t0 = now();
+    list_quicksort(&head);
+    double serial = now() - t0;
+    check_sorted(&head, n);
+
+    printf("n = %zu\n", n);
+    printf("%-22s %10.2f ms\n", "list_quicksort", serial * 1e3);
+
+    /* Leaf sorting networks against partitioning down to single nodes:
+     * best of LEAF_REPS runs per cutoff, taken in turns so drift in the
+     * machine's speed hits every cutoff alike, as a speedup over no leaf
+     * path.
+     */
+    static const struct {
+        const char *name;
+        int unique;
+    } inputs[] = {{"random", 0}, {"few-unique", 4096}};
+    static const int cutoffs[] = {0, 4, 8, 12, 16};
+#define NR_CUTOFFS (sizeof(cutoffs) / sizeof(cutoffs[0]))
+#define LEAF_REPS 5
+    printf("%-22s", "leaf cutoff");
+    for (size_t c = 0; c < NR_CUTOFFS; c++)
+        printf(" %9d", cutoffs[c]);
+    printf("\n");
+    for (size_t k = 0; k < sizeof(inputs) / sizeof(inputs[0]); k++) {
+        double best[NR_CUTOFFS];
+        for (int rep = 0; rep < LEAF_REPS; rep++) {
+            for (size_t c = 0; c < NR_CUTOFFS; c++) {
+                sort_leaf_cutoff = cutoffs[c];
+                fill(&head, items, n, inputs[k].unique);
+                t0 = now();
+                list_quicksort(&head);
+                double t = now() - t0;
+                check_sorted(&head, n);
+                best[c] = rep == 0 || t < best[c] ? t : best[c];
+            }
+        }
+        printf("%-22s %6.0f ms", inputs[k].name, best[0] * 1e3);
+        for (size_t c = 1; c < NR_CUTOFFS; c++)
+            printf(" %8.2fx", best[0] / best[c]);
+        printf("\n");
+    }
+    sort_leaf_cutoff = SORT_LEAF_CUTOFF;
+
+    /* Adaptive dispatch over differently shaped inputs. */
+    static const char *shapes[] = {"random",       "sorted",   "nearly-sorted",
+                                   "few-unique",   "narrow-range", "reversed",
+                                   "hot-key"};
+    for (size_t k = 0; k < sizeof(shapes) / sizeof(shapes[0]); k++) {
+        fill_shape(&head, items, n, (int) k);
+        struct list_sort_stats st;
+        list_adaptive_sort(&head, &st);
+        check_sorted(&head, n);
+        printf("adaptive %-13s %10.2f ms  path=%-5s choose=%.2f ms "
+               "runs=%zu inv=%.3f dup=%.3f span=%u\n",
+               shapes[k], (st.choose_ns + st.sort_ns) * 1e-6,
+               list_sort_path_name(st.path), st.choose_ns * 1e-6, st.runs,
+               st.inversion_ratio, st.dup_ratio, st.span);
+    }
+
+    for (int t = 1; t <= max_threads; t *= 2) {
+        struct tpool *pool = tpool_create(t);
+        assert(pool);
+        fill(&head, items, n, 0);
+        t0 = now();
+        list_sample_sort(&head, pool);
+        double elapsed = now() - t0;
+        check_sorted(&head, n);
+
+        char name[32];
+        snprintf(name, sizeof(name), "list_sample_sort T=%d", t);
+        printf("%-22s %10.2f ms  speedup %.2fx\n", name, elapsed * 1e3,
+               serial / elapsed);
+        tpool_destroy(pool);
+    }
+
+    /* Sample sort on inputs that defeat a first-element pivot. */
+    struct tpool *pool = tpool_create(max_threads);
+    assert(pool);
+    static const struct {
+        const char *name;
+        int shape, unique;
+    } sample_inputs[] = {{"sorted", 1, 0}, {"4 keys", -1, 4}};
+    for (size_t k = 0; k < sizeof(sample_inputs) / sizeof(sample_inputs[0]);
+         k++) {
+        if (sample_inputs[k].shape >= 0)
+            fill_shape(&head, items, n, sample_inputs[k].shape);
+        else
+            fill(&head, items, n, sample_inputs[k].unique);
+        t0 = now();
+        list_sample_sort(&head, pool);
+        double elapsed = now() - t0;
+        check_sorted(&head, n);
+        printf("list_sample_sort T=%d %-9s %8.2f ms\n", pool->nthreads,
+               sample_inputs[k].name, elapsed * 1e3);
+    }
+
+    /* Parallel quicksort by serial cutoff, with the pool's counters for
+     * each run, to tune PAR_CUTOFF.
+     */
+    static const size_t par_cutoffs[] = {512, 2048, 8192, 32768};
+    static const int par_shapes[] = {0, 1, 5}; /* random, sorted, reversed */
+    for (size_t k = 0; k < sizeof(par_shapes) / sizeof(par_shapes[0]); k++) {
+        for (size_t c = 0; c < sizeof(par_cutoffs) / sizeof(par_cutoffs[0]);
+             c++) {
+            fill_shape(&head, items, n, par_shapes[k]);
+            struct qsort_job job = {&head, n, par_cutoffs[c]};
+            tpool_reset_stats(pool);
+            t0 = now();
+            tpool_run(pool, list_quicksort_job, &job);
+            double elapsed = now() - t0;
+            check_sorted(&head, n);
+            struct tpool_stats st = tpool_get_stats(pool);
+            printf("list_quicksort_par T=%d %-8s cutoff=%-5zu %8.2f ms  "
+                   "tasks=%lu steals=%lu idle=%lu\n",
+                   pool->nthreads, shapes[par_shapes[k]], par_cutoffs[c],
+                   elapsed * 1e3, st.tasks, st.steals, st.idle);
+        }
+    }
+    tpool_destroy(pool);
+
+    free(items);
+    return 0;
+}
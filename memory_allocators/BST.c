@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "perf.h"
 
 typedef struct block {
     size_t size;
@@ -161,10 +162,20 @@ int main() {
         rand_table[idx2] = temp;
     }
 
-    for (int i = 0; i < array_size; i++) {
-        block_t *new = new_block(rand_table[i]->size);
-        insert_free_tree(&root, new);
+    PERF_REGION(insert_region, "insert_free_tree");
+    PERF_REGION(remove_region, "remove_free_tree");
+    block_t **new_table = malloc(array_size * sizeof(block_t *));
+    if (!new_table) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return EXIT_FAILURE;
     }
+    for (int i = 0; i < array_size; i++)
+        new_table[i] = new_block(rand_table[i]->size);
+    PERF_BEGIN(insert_region);
+    for (int i = 0; i < array_size; i++)
+        insert_free_tree(&root, new_table[i]);
+    PERF_END(insert_region);
+    free(new_table);
 
     for (int i = 0; i < array_size * 100; i++) {
         int idx1 = rand() % array_size;
@@ -174,10 +185,12 @@ int main() {
         rand_table[idx2] = temp;
     }
 
-    for (int i = 0; i < array_size; i++) {
-        block_t *remove_b = rand_table[i];
-        remove_free_tree(&root, remove_b);
-    }
+    PERF_BEGIN(remove_region);
+    for (int i = 0; i < array_size; i++)
+        remove_free_tree(&root, rand_table[i]);
+    PERF_END(remove_region);
+    PERF_REPORT(insert_region);
+    PERF_REPORT(remove_region);
 
     free(rand_table);
     return 0;
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "perf.h"
 
 typedef enum { RED, BLACK } color_t;
 
@@ -332,10 +333,15 @@ int main() {
         rand_table[idx2] = temp;
     }
     
-    for(int i = 0; i < array_size; i++) {
-        block_t *new = new_block(rand_table[i]);
-        rb_insert(&root, new);
-    }
+    PERF_REGION(insert_region, "rb_insert");
+    PERF_REGION(delete_region, "rb_delete");
+    block_t *blocks[array_size];
+    for(int i = 0; i < array_size; i++)
+        blocks[i] = new_block(rand_table[i]);
+    PERF_BEGIN(insert_region);
+    for(int i = 0; i < array_size; i++)
+        rb_insert(&root, blocks[i]);
+    PERF_END(insert_region);
     
     //generate_graviz(root);
     
@@ -350,9 +356,14 @@ int main() {
     // Remove the first 10 nodes
     for(int i = 0; i < array_size/2; i++) {
         //printf("remove: %d\n", rand_table[i]);
-        block_t *target = find_block(root, rand_table[i]);
-        rb_delete(&root, target);
+        blocks[i] = find_block(root, rand_table[i]);
     }
+    PERF_BEGIN(delete_region);
+    for(int i = 0; i < array_size/2; i++)
+        rb_delete(&root, blocks[i]);
+    PERF_END(delete_region);
+    PERF_REPORT(insert_region);
+    PERF_REPORT(delete_region);
     // Print the tree after remove nodes
     //generate_graviz(root);
     return 0;
@@ -1,4 +1,7 @@
 #include "list.h"
+#include "perf.h"
+#include "sort_count.h"
+#include "sort_network.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -61,6 +64,46 @@ struct list_head *list_tail(struct list_head *head)
     return head;
 }
 
+/* Same as list_tail(), also reporting the number of nodes in @len. */
+static struct list_head *list_tail_len(struct list_head *head, int *len)
+{
+    int n = head ? 1 : 0;
+    while (head && head->next) {
+        head = head->next;
+        n++;
+    }
+    *len = n;
+    return head;
+}
+
+/* Sort a short NULL-terminated sublist with a sorting network and push its
+ * nodes onto @result, largest first, the way quick_sort() emits singletons.
+ * A sublist already in order, such as a run of one duplicated value, skips
+ * the network.
+ */
+static struct list_head *sort_leaf(struct list_head *L,
+                                   int len,
+                                   struct list_head *result)
+{
+    long keys[16];
+    void *nodes[16];
+    bool sorted = true;
+
+    for (int j = 0; j < len; j++, L = L->next) {
+        keys[j] = list_entry(L, node_t, list)->value;
+        nodes[j] = L;
+        sorted &= j == 0 || keys[j] >= keys[j - 1];
+    }
+    if (!sorted)
+        sort_network_kv(keys, nodes, len);
+    for (int j = len - 1; j >= 0; j--) {
+        struct list_head *n = nodes[j];
+        n->next = result;
+        result = n;
+    }
+    return result;
+}
+
 int list_length(struct list_head *left)
 {
     int n = 0;
@@ -102,8 +145,12 @@ void quick_sort(struct list_head *list) {
     begin[0] = list->next;
     list->prev->next = NULL;
     while (i >= 0) {
-        struct list_head *L = begin[i], *R = list_tail(begin[i]);
-        if (L != R) {
+        int len;
+        struct list_head *L = begin[i], *R = list_tail_len(begin[i], &len);
+        if (len > 1 && len <= SORT_LEAF_CUTOFF) {
+            result = sort_leaf(L, len, result);
+            i--;
+        } else if (L != R) {
             struct list_head *pivot = L;
             value = list_entry(pivot, node_t, list)->value; //HHHH
             struct list_head *p = pivot->next;
@@ -113,6 +160,8 @@ void quick_sort(struct list_head *list) {
                 struct list_head *n = p;
                 p = p->next;
                 int n_value = list_entry(n, node_t, list)->value; //IIII
+                SORT_COUNT_CMP();
+                SORT_COUNT_MOVE();
                 if (n_value > value) {
                     n->next = right;
                     right = n;
@@ -127,10 +176,12 @@ void quick_sort(struct list_head *list) {
             begin[i + 2] = right; //KKKK
             left = right = NULL;
             i += 2;
+            SORT_COUNT_DEPTH(i + 1);
         } else {
             if (L) {
                 L->next = result;
                 result = L;
+                SORT_COUNT_MOVE();
             }
             i--;
         }
@@ -146,16 +197,24 @@ int main(int argc, char **argv)
     struct list_head *list = malloc(sizeof(struct list_head));
     INIT_LIST_HEAD(list);
 
-    size_t count = 100000;
+    /* ./main [count] [unique]: @unique > 0 repeats that many values. */
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    int unique = argc > 2 ? atoi(argv[2]) : 0;
     int *test_arr = malloc(sizeof(int) * count);
     for (int i = 0; i < count; ++i)
-        test_arr[i] = i;
+        test_arr[i] = unique > 0 ? i % unique : i;
     shuffle(test_arr, count);
 
     while (count--)
         list_construct(list, test_arr[count]);
     
+    PERF_REGION(sort_region, "quick_sort");
+    SORT_COUNT_RESET();
+    PERF_BEGIN(sort_region);
     quick_sort(list);
+    PERF_END(sort_region);
+    PERF_REPORT(sort_region);
+    SORT_COUNT_REPORT("quick_sort");
     //assert(list_is_ordered(list));
     print_list(list);
     list_free(list);
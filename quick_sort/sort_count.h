@@ -0,0 +1,79 @@
+/* Compile-time switchable operation counters for the list sorts */
+
+#pragma once
+
+#include <stdio.h>
+
+/**
+ * Build with -DSORT_COUNT to enable. Otherwise every hook expands to
+ * ((void) 0) and the sort bodies compile exactly as before.
+ *
+ * Counters are reset with SORT_COUNT_RESET() before a sort call and printed
+ * with SORT_COUNT_REPORT(name) afterwards:
+ * - cmps:      key comparisons
+ * - moves:     nodes moved between lists (list_move_tail, relinking)
+ * - splices:   list_splice / list_splice_tail calls
+ * - max_depth: deepest recursion level, or the highest explicit stack slot
+ *              used by iterative sorts
+ *
+ * A max_depth close to the element count means the pivot choice degenerated,
+ * e.g. a first-element pivot on already sorted input.
+ */
+
+#ifdef SORT_COUNT
+#include <stdatomic.h>
+
+/* The totals are relaxed atomics, since tpool workers sort parts of one
+ * list at once; the current depth is per thread, so max_depth is the
+ * deepest any one thread's stack got.
+ */
+struct sort_count {
+    atomic_ulong cmps, moves, splices, max_depth;
+};
+
+static struct sort_count sort_count;
+static _Thread_local unsigned long sort_count_depth;
+
+static inline void sort_count_max_depth(unsigned long d)
+{
+    unsigned long max = atomic_load_explicit(&sort_count.max_depth,
+                                             memory_order_relaxed);
+    while (d > max && !atomic_compare_exchange_weak_explicit(
+                          &sort_count.max_depth, &max, d,
+                          memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+#define SORT_COUNT_ADD(field) \
+    atomic_fetch_add_explicit(&sort_count.field, 1, memory_order_relaxed)
+#define SORT_COUNT_CMP() SORT_COUNT_ADD(cmps)
+#define SORT_COUNT_MOVE() SORT_COUNT_ADD(moves)
+#define SORT_COUNT_SPLICE() SORT_COUNT_ADD(splices)
+#define SORT_COUNT_ENTER() sort_count_max_depth(++sort_count_depth)
+#define SORT_COUNT_LEAVE() (sort_count_depth--)
+#define SORT_COUNT_DEPTH(d) sort_count_max_depth((unsigned long) (d))
+#define SORT_COUNT_RESET()                       \
+    do {                                         \
+        atomic_store(&sort_count.cmps, 0);       \
+        atomic_store(&sort_count.moves, 0);      \
+        atomic_store(&sort_count.splices, 0);    \
+        atomic_store(&sort_count.max_depth, 0);  \
+        sort_count_depth = 0;                    \
+    } while (0)
+#define SORT_COUNT_REPORT(name)                                          \
+    fprintf(stderr,                                                      \
+            "[count] %s: cmps=%lu moves=%lu splices=%lu max_depth=%lu\n", \
+            name, atomic_load(&sort_count.cmps),                         \
+            atomic_load(&sort_count.moves),                              \
+            atomic_load(&sort_count.splices),                            \
+            atomic_load(&sort_count.max_depth))
+#else
+#define SORT_COUNT_CMP() ((void) 0)
+#define SORT_COUNT_MOVE() ((void) 0)
+#define SORT_COUNT_SPLICE() ((void) 0)
+#define SORT_COUNT_ENTER() ((void) 0)
+#define SORT_COUNT_LEAVE() ((void) 0)
+#define SORT_COUNT_DEPTH(d) ((void) 0)
+#define SORT_COUNT_RESET() ((void) 0)
+#define SORT_COUNT_REPORT(name) ((void) 0)
+#endif
@@ -0,0 +1,124 @@
+/* Branchless sorting networks for the leaves of the list sorts */
+
+#pragma once
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Partitions with at most SORT_LEAF_CUTOFF nodes are not partitioned any
+ * further: their keys are copied into a small local array, sorted with a
+ * fixed sorting network, and the nodes are relinked in one pass. Build with
+ * -DSORT_LEAF_CUTOFF=0 to disable the leaf path entirely.
+ *
+ * Each network is a fixed sequence of compare-exchange steps on constant
+ * indices, so the compiler keeps the keys in registers and turns every step
+ * into min/max or conditional moves instead of data-dependent branches.
+ * Inputs are padded with a maximal sentinel to the next network size.
+ */
+#ifndef SORT_LEAF_CUTOFF
+#define SORT_LEAF_CUTOFF 16
+#endif
+
+#if SORT_LEAF_CUTOFF > 16
+#error "SORT_LEAF_CUTOFF must not exceed 16, the largest network provided"
+#endif
+
+/* Optimal-size networks: 5, 19 and 60 comparators. */
+#define SORT_NETWORK_4(CE) CE(0, 1) CE(2, 3) CE(0, 2) CE(1, 3) CE(1, 2)
+
+#define SORT_NETWORK_8(CE)                                               \
+    CE(0, 2) CE(1, 3) CE(4, 6) CE(5, 7) CE(0, 4) CE(1, 5) CE(2, 6)       \
+    CE(3, 7) CE(0, 1) CE(2, 3) CE(4, 5) CE(6, 7) CE(2, 4) CE(3, 5)       \
+    CE(1, 4) CE(3, 6) CE(1, 2) CE(3, 4) CE(5, 6)
+
+#define SORT_NETWORK_16(CE)                                              \
+    CE(0, 13) CE(1, 12) CE(2, 15) CE(3, 14) CE(4, 8) CE(5, 6) CE(7, 11)  \
+    CE(9, 10) CE(0, 5) CE(1, 7) CE(2, 9) CE(3, 4) CE(6, 13) CE(8, 14)    \
+    CE(10, 15) CE(11, 12) CE(0, 1) CE(2, 3) CE(4, 5) CE(6, 8) CE(7, 9)   \
+    CE(10, 11) CE(12, 13) CE(14, 15) CE(0, 2) CE(1, 3) CE(4, 10)         \
+    CE(5, 11) CE(6, 7) CE(8, 9) CE(12, 14) CE(13, 15) CE(1, 2)           \
+    CE(3, 12) CE(4, 6) CE(5, 7) CE(8, 10) CE(9, 11) CE(13, 14) CE(1, 4)  \
+    CE(2, 6) CE(5, 8) CE(7, 10) CE(9, 13) CE(11, 14) CE(2, 4) CE(3, 6)   \
+    CE(9, 12) CE(11, 13) CE(3, 5) CE(6, 8) CE(7, 9) CE(10, 12) CE(3, 4)  \
+    CE(5, 6) CE(7, 8) CE(9, 10) CE(11, 12) CE(6, 7) CE(8, 9)
+
+#define SORT_NETWORK_RUN(size, CE) \
+    do {                           \
+        if ((size) == 4) {         \
+            SORT_NETWORK_4(CE)     \
+        } else if ((size) == 8) {  \
+            SORT_NETWORK_8(CE)     \
+        } else {                   \
+            SORT_NETWORK_16(CE)    \
+        }                          \
+    } while (0)
+
+static inline int sort_network_size(int n)
+{
+    return n <= 4 ? 4 : n <= 8 ? 8 : 16;
+}
+
+/* Compare-exchange on packed keys. */
+#define SORT_NETWORK_CE_U32(a, b)         \
+    {                                     \
+        uint32_t x_ = v[a], y_ = v[b];    \
+        v[a] = x_ < y_ ? x_ : y_;         \
+        v[b] = x_ < y_ ? y_ : x_;         \
+    }
+
+/**
+ * sort_network_u32() - sort up to 16 packed 32-bit keys in place
+ *
+ * Callers pack the sort key into the high bits and the node's index into the
+ * low bits, which makes every key unique and the result stable.
+ */
+static inline void sort_network_u32(uint32_t *keys, int n)
+{
+    uint32_t v[16];
+    int size = sort_network_size(n);
+
+    for (int i = 0; i < size; i++)
+        v[i] = i < n ? keys[i] : UINT32_MAX;
+    SORT_NETWORK_RUN(size, SORT_NETWORK_CE_U32);
+    for (int i = 0; i < n; i++)
+        keys[i] = v[i];
+}
+
+/* Compare-exchange on a key and its attached pointer. */
+#define SORT_NETWORK_CE_KV(a, b)                   \
+    {                                              \
+        long ka_ = k[a], kb_ = k[b];               \
+        void *pa_ = p[a], *pb_ = p[b];             \
+        int swap_ = kb_ < ka_;                     \
+        k[a] = swap_ ? kb_ : ka_;                  \
+        k[b] = swap_ ? ka_ : kb_;                  \
+        p[a] = swap_ ? pb_ : pa_;                  \
+        p[b] = swap_ ? pa_ : pb_;                  \
+    }
+
+/**
+ * sort_network_kv() - sort up to 16 long keys together with their pointers
+ *
+ * Padding slots carry LONG_MAX and a NULL pointer; after sorting they are at
+ * the end, or tied with real LONG_MAX keys, so callers skip NULL entries.
+ */
+static inline void sort_network_kv(long *keys, void **vals, int n)
+{
+    long k[16];
+    void *p[16];
+    int size = sort_network_size(n);
+
+    for (int i = 0; i < size; i++) {
+        k[i] = i < n ? keys[i] : LONG_MAX;
+        p[i] = i < n ? vals[i] : NULL;
+    }
+    SORT_NETWORK_RUN(size, SORT_NETWORK_CE_KV);
+    for (int i = 0, j = 0; i < size; i++) {
+        if (p[i]) {
+            keys[j] = k[i];
+            vals[j++] = p[i];
+        }
+    }
+}
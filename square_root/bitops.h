@@ -0,0 +1,208 @@
+/* Leading/trailing zero counts, popcount and ilog2 in three tiers */
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+/**
+ * Usage:
+ *
+ *   int shift = ilog2_64(x) & ~1;           // inline, best known at build
+ *   unsigned z = bitops.clz32(x);           // picked from CPUID at startup
+ *   static const uint8_t t[] = {BITOPS_CLZ32_CONST(5), ...};
+ *
+ * Tiers, fastest first:
+ *
+ *   hardware  LZCNT/TZCNT/POPCNT, each defined for 0. clz32() and friends
+ *             inline them when the build targets them (-mlzcnt, -mbmi,
+ *             -mpopcnt or -march=native) and otherwise inline BSR/BSF via
+ *             __builtin_clz/ctz, which every x86-64 has, with the zero case
+ *             folded into a conditional move.
+ *   de Bruijn branchless multiply-and-lookup versions for compilers without
+ *             the builtins; also what the bitops table starts out with.
+ *   constant  BITOPS_*_CONST() macros, plain integer constant expressions
+ *             for static tables and _Static_assert. They expand @x 32 times,
+ *             so pass them constants or side-effect free expressions.
+ *
+ * The bitops table holds the best of the first two tiers this CPU supports,
+ * filled in by bitops_init() from CPUID before main() runs; calls through it
+ * cost an indirect call, so hot loops should use the inline functions.
+ *
+ * All counts of a zero input are the width (32 or 64); ilog2 of zero is -1.
+ */
+
+/* Constant tier: ilog2 by halving, clz and ctz from it. */
+#define BITOPS_ILOG2_2_(x) (((x) & 0x2u) ? 1 : 0)
+#define BITOPS_ILOG2_4_(x) \
+    (((x) & 0xCu) ? 2 + BITOPS_ILOG2_2_((x) >> 2) : BITOPS_ILOG2_2_(x))
+#define BITOPS_ILOG2_8_(x) \
+    (((x) & 0xF0u) ? 4 + BITOPS_ILOG2_4_((x) >> 4) : BITOPS_ILOG2_4_(x))
+#define BITOPS_ILOG2_16_(x) \
+    (((x) & 0xFF00u) ? 8 + BITOPS_ILOG2_8_((x) >> 8) : BITOPS_ILOG2_8_(x))
+#define BITOPS_ILOG2_32_(x)                                 \
+    (((x) & 0xFFFF0000u) ? 16 + BITOPS_ILOG2_16_((x) >> 16) \
+                         : BITOPS_ILOG2_16_(x))
+
+#define BITOPS_ILOG2_CONST(x) \
+    ((uint32_t) (x) ? BITOPS_ILOG2_32_((uint32_t) (x)) : -1)
+#define BITOPS_CLZ32_CONST(x) (31 - BITOPS_ILOG2_CONST(x))
+#define BITOPS_CTZ32_CONST(x)                                          \
+    ((uint32_t) (x) ? BITOPS_ILOG2_32_((uint32_t) (x) & -(uint32_t) (x)) \
+                    : 32)
+
+/* de Bruijn tier */
+static const uint8_t bitops_debruijn_log2[32] = {
+    0,  9,  1,  10, 13, 21, 2,  29, 11, 14, 16, 18, 22, 25, 3, 30,
+    8,  12, 20, 28, 15, 17, 24, 7,  19, 27, 23, 6,  26, 5,  4, 31,
+};
+
+static const uint8_t bitops_debruijn_ctz[32] = {
+    0,  1,  28, 2,  29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4,  8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6,  11, 5,  10, 9,
+};
+
+static inline unsigned clz32_debruijn(uint32_t x)
+{
+    /* Smear the top bit down, so x + 1 would be a power of two. */
+    uint32_t s = x;
+    s |= s >> 1;
+    s |= s >> 2;
+    s |= s >> 4;
+    s |= s >> 8;
+    s |= s >> 16;
+    return 31 - bitops_debruijn_log2[(s * 0x07C4ACDDu) >> 27] + (x == 0);
+}
+
+static inline unsigned ctz32_debruijn(uint32_t x)
+{
+    /* x & -x keeps the lowest set bit, a power of two the multiply shifts. */
+    return bitops_debruijn_ctz[((x & -x) * 0x077CB531u) >> 27] +
+           32 * (x == 0);
+}
+
+static inline unsigned popcount32_swar(uint32_t x)
+{
+    x -= (x >> 1) & 0x55555555u;
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (x * 0x01010101u) >> 24;
+}
+
+/* Hardware tier, for the table: compiled for the instruction regardless of
+ * the build flags and only ever called once CPUID has reported it.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("lzcnt"))) static inline unsigned clz32_lzcnt(
+    uint32_t x)
+{
+    return _lzcnt_u32(x);
+}
+
+__attribute__((target("bmi"))) static inline unsigned ctz32_tzcnt(uint32_t x)
+{
+    return _tzcnt_u32(x);
+}
+
+__attribute__((target("popcnt"))) static inline unsigned popcount32_popcnt(
+    uint32_t x)
+{
+    return __builtin_popcount(x);
+}
+#endif
+
+/* Inline tier: the best the build flags allow, no dispatch. */
+static inline unsigned clz32(uint32_t x)
+{
+#if defined(__LZCNT__)
+    return _lzcnt_u32(x);
+#elif defined(__GNUC__)
+    return x ? (unsigned) __builtin_clz(x) : 32;
+#else
+    return clz32_debruijn(x);
+#endif
+}
+
+static inline unsigned ctz32(uint32_t x)
+{
+#if defined(__BMI__)
+    return _tzcnt_u32(x);
+#elif defined(__GNUC__)
+    return x ? (unsigned) __builtin_ctz(x) : 32;
+#else
+    return ctz32_debruijn(x);
+#endif
+}
+
+static inline unsigned popcount32(uint32_t x)
+{
+#if defined(__GNUC__)
+    return __builtin_popcount(x); /* POPCNT under -mpopcnt, else SWAR */
+#else
+    return popcount32_swar(x);
+#endif
+}
+
+static inline unsigned clz64(uint64_t x)
+{
+    uint32_t hi = (uint32_t) (x >> 32);
+    return hi ? clz32(hi) : 32 + clz32((uint32_t) x);
+}
+
+static inline unsigned ctz64(uint64_t x)
+{
+    uint32_t lo = (uint32_t) x;
+    return lo ? ctz32(lo) : 32 + ctz32((uint32_t) (x >> 32));
+}
+
+static inline unsigned popcount64(uint64_t x)
+{
+    return popcount32((uint32_t) x) + popcount32((uint32_t) (x >> 32));
+}
+
+/* Index of the highest set bit, or -1 for zero. */
+static inline int ilog2_32(uint32_t x)
+{
+    return 31 - (int) clz32(x);
+}
+
+static inline int ilog2_64(uint64_t x)
+{
+    return 63 - (int) clz64(x);
+}
+
+/* Dispatch tier */
+struct bitops {
+    unsigned (*clz32)(uint32_t);
+    unsigned (*ctz32)(uint32_t);
+    unsigned (*popcount32)(uint32_t);
+    const char *clz_name, *ctz_name, *popcount_name;
+};
+
+static struct bitops bitops = {
+    clz32_debruijn, ctz32_debruijn, popcount32_swar,
+    "de Bruijn",    "de Bruijn",    "SWAR",
+};
+
+__attribute__((constructor)) static void bitops_init(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned a, b, c, d;
+    if (__get_cpuid(0x80000001, &a, &b, &c, &d) && (c & bit_LZCNT)) {
+        bitops.clz32 = clz32_lzcnt;
+        bitops.clz_name = "LZCNT";
+    }
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_BMI)) {
+        bitops.ctz32 = ctz32_tzcnt;
+        bitops.ctz_name = "TZCNT";
+    }
+    if (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_POPCNT)) {
+        bitops.popcount32 = popcount32_popcnt;
+        bitops.popcount_name = "POPCNT";
+    }
+#endif
+}
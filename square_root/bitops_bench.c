@@ -0,0 +1,207 @@
+/* Exhaustive check and timing of bitops.h against the old recursive clz2()
+ *
+ * Build: gcc -O2 -o bitops_bench bitops_bench.c
+ * Usage: ./bitops_bench [n]
+ *
+ * Every 32-bit input goes through each tier of clz32, ctz32, popcount32 and
+ * ilog2_32 and is compared with a reference built on clz2(), the recursive
+ * count sqrti() used before; the 64-bit versions are checked on random
+ * inputs against their two halves. Then each implementation is timed over
+ * @n random inputs, as is sqrti() with either clz.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bitops.h"
+
+_Static_assert(BITOPS_CLZ32_CONST(0) == 32, "clz of 0 is the width");
+_Static_assert(BITOPS_CLZ32_CONST(1) == 31, "");
+_Static_assert(BITOPS_CLZ32_CONST(0x80000000u) == 0, "");
+_Static_assert(BITOPS_CTZ32_CONST(0x80000000u) == 31, "");
+_Static_assert(BITOPS_ILOG2_CONST(0) == -1, "ilog2 of 0 is -1");
+
+/* What a compile-time table looks like: clz of every byte. */
+#define CLZ8(x) (BITOPS_CLZ32_CONST(x) - 24)
+#define CLZ8_ROW(r)                                                       \
+    CLZ8(r + 0), CLZ8(r + 1), CLZ8(r + 2), CLZ8(r + 3), CLZ8(r + 4),      \
+        CLZ8(r + 5), CLZ8(r + 6), CLZ8(r + 7), CLZ8(r + 8), CLZ8(r + 9),  \
+        CLZ8(r + 10), CLZ8(r + 11), CLZ8(r + 12), CLZ8(r + 13),           \
+        CLZ8(r + 14), CLZ8(r + 15)
+static const uint8_t clz8_table[256] = {
+    CLZ8_ROW(0),   CLZ8_ROW(16),  CLZ8_ROW(32),  CLZ8_ROW(48),
+    CLZ8_ROW(64),  CLZ8_ROW(80),  CLZ8_ROW(96),  CLZ8_ROW(112),
+    CLZ8_ROW(128), CLZ8_ROW(144), CLZ8_ROW(160), CLZ8_ROW(176),
+    CLZ8_ROW(192), CLZ8_ROW(208), CLZ8_ROW(224), CLZ8_ROW(240),
+};
+
+/* The recursive count square_root.c had, kept as the reference. */
+static const int mask[] = {0, 8, 12, 14};
+static const int magic[] = {1, 1, 0, 0};
+
+static unsigned clz2(uint32_t x, int c)
+{
+    if (!x && !c)
+        return 32;
+
+    uint32_t upper = (x >> (16 >> c));
+    uint32_t lower = (x & (0xFFFF >> mask[c]));
+    if (c == 3)
+        return upper ? magic[upper] : 2 + magic[lower];
+    return upper ? clz2(upper, c + 1) : (16 >> (c)) + clz2(lower, c + 1);
+}
+
+static inline unsigned clz2_64(uint64_t x)
+{
+    return (x >> 32) ? clz2((uint32_t) (x >> 32), 0)
+                     : clz2((uint32_t) x, 0) + 32;
+}
+
+static uint8_t pop16[1 << 16];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t rand64(void)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < 4; i++)
+        r = r << 16 ^ (uint64_t) (rand() & 0xFFFF);
+    return r;
+}
+
+static void fail(const char *what, uint64_t x, unsigned got, unsigned want)
+{
+    fprintf(stderr, "%s(%#lx) = %u, expected %u\n", what, (unsigned long) x,
+            got, want);
+    exit(1);
+}
+
+#define CHECK(what, x, got, want)               \
+    do {                                        \
+        unsigned g_ = (got), w_ = (want);       \
+        if (g_ != w_)                           \
+            fail(what, x, g_, w_);              \
+    } while (0)
+
+static void check_all(void)
+{
+    for (int i = 1; i < 1 << 16; i++)
+        pop16[i] = pop16[i >> 1] + (i & 1);
+
+    uint32_t x = 0;
+    do {
+        unsigned clz = clz2(x, 0);
+        unsigned ctz = x ? 31 - clz2(x & -x, 0) : 32;
+        unsigned pop = pop16[x & 0xFFFF] + pop16[x >> 16];
+
+        CHECK("clz32", x, clz32(x), clz);
+        CHECK("clz32_debruijn", x, clz32_debruijn(x), clz);
+        CHECK("bitops.clz32", x, bitops.clz32(x), clz);
+        CHECK("BITOPS_CLZ32_CONST", x, BITOPS_CLZ32_CONST(x), clz);
+        CHECK("ilog2_32", x, ilog2_32(x), 31 - (int) clz);
+        CHECK("BITOPS_ILOG2_CONST", x, BITOPS_ILOG2_CONST(x), 31 - (int) clz);
+        CHECK("ctz32", x, ctz32(x), ctz);
+        CHECK("ctz32_debruijn", x, ctz32_debruijn(x), ctz);
+        CHECK("bitops.ctz32", x, bitops.ctz32(x), ctz);
+        CHECK("BITOPS_CTZ32_CONST", x, BITOPS_CTZ32_CONST(x), ctz);
+        CHECK("popcount32", x, popcount32(x), pop);
+        CHECK("popcount32_swar", x, popcount32_swar(x), pop);
+        CHECK("bitops.popcount32", x, bitops.popcount32(x), pop);
+        if (x < 256)
+            CHECK("clz8_table", x, clz8_table[x], clz - 24);
+    } while (++x);
+
+    for (int i = 0; i < 1 << 24; i++) {
+        /* Random widths, so every clz64 and ctz64 shows up. */
+        uint64_t y = rand64() >> (i & 63);
+        if (i & 64)
+            y <<= (i >> 7) & 63;
+        unsigned lo = (uint32_t) y ? 31 - clz2((uint32_t) (y & -y), 0) : 32;
+        unsigned ctz = (uint32_t) y || !y
+                           ? lo + (y ? 0 : 32)
+                           : 32 + 31 - clz2((uint32_t) ((y & -y) >> 32), 0);
+        CHECK("clz64", y, clz64(y), clz2_64(y));
+        CHECK("ilog2_64", y, ilog2_64(y), 63 - (int) clz2_64(y));
+        CHECK("ctz64", y, ctz64(y), ctz);
+        CHECK("popcount64", y, popcount64(y),
+              pop16[y & 0xFFFF] + pop16[(y >> 16) & 0xFFFF] +
+                  pop16[(y >> 32) & 0xFFFF] + pop16[y >> 48]);
+    }
+    printf("checks passed: all 2^32 inputs, 2^24 random 64-bit inputs\n");
+}
+
+static volatile unsigned sink;
+
+#define TIME(name, expr)                                           \
+    do {                                                           \
+        unsigned acc = 0;                                          \
+        double t0 = now();                                         \
+        for (size_t i = 0; i < n; i++) {                           \
+            uint32_t x = in[i];                                    \
+            acc += (expr);                                         \
+        }                                                          \
+        double t = now() - t0;                                     \
+        sink = acc;                                                \
+        printf("%-22s %8.2f ns/op\n", name, t * 1e9 / n);          \
+    } while (0)
+
+/* sqrti() from square_root.c, with the clz passed in. */
+#define SQRTI(name, clz64_fn)                                      \
+    static uint64_t name(uint64_t x)                               \
+    {                                                              \
+        uint64_t m, y = 0;                                         \
+        if (x <= 1)                                                \
+            return x;                                              \
+        m = 1ULL << ((63 - clz64_fn(x)) & ~1);                     \
+        while (m) {                                                \
+            uint64_t b = y + m;                                    \
+            y >>= 1;                                               \
+            if (x >= b) {                                          \
+                x -= b;                                            \
+                y += m;                                            \
+            }                                                      \
+            m >>= 2;                                               \
+        }                                                          \
+        return y;                                                  \
+    }
+SQRTI(sqrti_clz2, clz2_64)
+SQRTI(sqrti_bitops, clz64)
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 24;
+
+    check_all();
+    printf("dispatch: clz %s, ctz %s, popcount %s\n", bitops.clz_name,
+           bitops.ctz_name, bitops.popcount_name);
+
+    uint32_t *in = malloc(sizeof(uint32_t) * n);
+    assert(in);
+    srand(1);
+    for (size_t i = 0; i < n; i++) /* random widths, not mostly 32 bits */
+        in[i] = (uint32_t) rand64() >> (rand() & 31);
+
+    TIME("clz2 (recursive)", clz2(x, 0));
+    TIME("clz32 (inline)", clz32(x));
+    TIME("clz32_debruijn", clz32_debruijn(x));
+    TIME("bitops.clz32", bitops.clz32(x));
+    TIME("ctz32 (inline)", ctz32(x));
+    TIME("ctz32_debruijn", ctz32_debruijn(x));
+    TIME("bitops.ctz32", bitops.ctz32(x));
+    TIME("popcount32 (inline)", popcount32(x));
+    TIME("popcount32_swar", popcount32_swar(x));
+    TIME("bitops.popcount32", bitops.popcount32(x));
+    TIME("sqrti with clz2", sqrti_clz2((uint64_t) x << 16 | x));
+    TIME("sqrti with clz64", sqrti_bitops((uint64_t) x << 16 | x));
+
+    free(in);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/* Float square root approximations and the exponent-seeded binary search */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Q_rsqrt() is the magic-constant reciprocal square root with three Newton
+ * steps, Q_sqrt() inverts its result with three more, and Bi_sqrt() halves
+ * the float exponent of n for a starting interval and binary-searches the
+ * integer root inside it. sqrt_check measures all three over every 32-bit
+ * input; rsqrt.h has the vectorized, tunable versions of the first two.
+ *
+ * The float seed can put the root outside Bi_sqrt()'s interval, where the
+ * search never settles; it gives up after BI_SQRT_MAX_STEPS probes and
+ * returns BI_SQRT_FAILED rather than spin forever. Negative n, which used
+ * to spin too, returns it straight away.
+ */
+
+#ifndef BI_SQRT_MAX_STEPS
+#define BI_SQRT_MAX_STEPS 64
+#endif
+#define BI_SQRT_FAILED (-1)
+
+static inline float Q_rsqrt(float number)
+{
+	int32_t i;
+	float x2, y;
+	const float threehalfs = 1.5F;
+
+	x2 = number * 0.5F;
+	y  = number;
+	memcpy(&i, &y, sizeof(i));                  // evil floating point bit level hacking
+	i  = (int32_t) (0x5f3759dfu - (uint32_t) ( i >> 1 )); // what the fuck?
+	memcpy(&y, &i, sizeof(y));
+	y  = y * ( threehalfs - ( x2 * y * y ) );   // 1st iteration
+	y  = y * ( threehalfs - ( x2 * y * y ) );   // 2nd iteration, this can be removed
+	y  = y * ( threehalfs - ( x2 * y * y ) );
+	
+	return y;
+}
+
+static inline float Q_sqrt(float number)
+{
+
+	float rsqrt = Q_rsqrt(number);
+	float y = rsqrt;
+	
+	int32_t i;
+	memcpy(&i, &y, sizeof(i));
+	i  = (int32_t) (0x7F000000u - (uint32_t) i); // Do the reciprocal to the exponent
+	memcpy(&y, &i, sizeof(y));                   // Convert the extimate value back to float
+	y = y * (2 - rsqrt * y);
+	y = y * (2 - rsqrt * y);
+	y = y * (2 - rsqrt * y);
+	return y;
+}
+
+static inline int32_t Bi_sqrt(int n)
+{ 
+    if (n < 0)
+        return BI_SQRT_FAILED;
+    float y = n;
+    
+    int32_t i;
+    memcpy(&i, &y, sizeof(i));
+    //printf("Before i: %x\n", i);
+    i >>= 23;                              // Do the reciprocal to the exponent
+    i = ((i - 127) >> 1) + 127;            // Deivde the exponent by 2
+    i = (int32_t) ((uint32_t) i << 23);
+    //printf("After i: %x\n", i);
+    memcpy(&y, &i, sizeof(y));
+    
+    i = (int32_t) y;
+    // Do the binary search to estimate value;
+    unsigned int head = i;                 // 2^i
+    unsigned int tail = (head + 1) << 1;   // 2^(i+1)
+    unsigned int mid = (head + tail) >> 1; // same as (2^m + 2^(m+1)) / 2
+    for (int steps = 0;; steps++) {
+        if (steps == BI_SQRT_MAX_STEPS)
+            return BI_SQRT_FAILED;
+        if ((unsigned) n > (mid + 1) * (mid + 1)) {
+            head = mid; 
+            mid = (head + tail) >> 1;
+        } else if ((unsigned) n < mid * mid) {
+            tail = mid; 
+            mid = (head + tail) >> 1;
+        } else
+            break;
+    }
+    return mid;
+}
@@ -0,0 +1,355 @@
+/* Fast reciprocal square roots and square roots over float/double arrays */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Usage:
+ *
+ *   rsqrtf_array(in, out, n, 1);            // out[i] ~ 1 / sqrtf(in[i])
+ *   sqrt_array(din, dout, n, 2);            // dout[i] ~ sqrt(din[i])
+ *   float r = rsqrtf_fast(x, 2);            // one value, portable seed
+ *
+ * Every call takes the number of Newton-Raphson steps, 0 to 3, that refine a
+ * cheap first estimate, y <- y * (1.5 - x / 2 * y * y); each step roughly
+ * doubles the correct bits, so call sites pick their own point between
+ * throughput and accuracy. The estimate comes from, best first:
+ *
+ *   AVX-512   vrsqrt14ps / vrsqrt14pd, relative error below 2^-14
+ *   AVX2      vrsqrtps, relative error below 1.5 * 2^-12; for double,
+ *             on x scaled into [1, 4) by an even power of two
+ *   scalar    for double, rsqrtss on x scaled the same way, wherever SSE
+ *             is there (every x86-64); for float, and for double elsewhere,
+ *             the integer seed: halve the bit pattern and subtract it from
+ *             a magic constant (0x5f375a86 for float, 0x5fe6eb50c7b537a9
+ *             for double), about 2^-5
+ *
+ * Bit patterns move between float and integer with memcpy() or vector
+ * casts, never through a pointer of the other type, so there is no strict
+ * aliasing violation, and the integers are fixed-width. The square root is
+ * x * rsqrt(x); sqrt of +-0 is that zero.
+ *
+ * Inputs must be positive, finite and normal (sqrt also allows zero). Other
+ * values give unspecified results: the seeds differ on zero, denormals,
+ * infinities and NaN, and Newton steps do not repair that.
+ *
+ * Worst error in ULPs of the correctly rounded result, measured by
+ * rsqrt_bench over every float in [1, 4) (the error repeats every two
+ * binades) plus 2^22 random positive normal floats, and over 2^24 random
+ * doubles in [1, 4) plus 2^22 random positive normal doubles:
+ *
+ *                        Newton steps:     0         1         2       3
+ *   float rsqrt  AVX-512                 938      2.69      2.41    2.33
+ *                AVX2                   4980      4.13      2.56    2.54
+ *                scalar              5.7e+05   2.8e+04      73.3    2.98
+ *   float sqrt   AVX-512                 739      2.58      1.92    1.85
+ *                AVX2                   4100      4.08      1.93    1.75
+ *                scalar              5.7e+05   2.8e+04      76.9    2.51
+ *   double rsqrt AVX-512             5.0e+11   4.3e+07      2.34    2.24
+ *                AVX2                2.7e+12   1.2e+09       242    2.46
+ *                scalar (SSE)        2.7e+12   1.2e+09       242    2.46
+ *   double sqrt  AVX-512             4.0e+11   3.5e+07      2.69    1.80
+ *                AVX2                2.2e+12   1.0e+09       246    2.66
+ *                scalar (SSE)        2.2e+12   1.0e+09       246    2.66
+ *
+ * About 2 ULPs stay once the estimate has converged, from rounding in the
+ * Newton step itself; use sqrtf()/sqrt() where that matters. The integer
+ * seed for double, left only where there is no SSE, has not converged
+ * after three steps: they leave a relative error near 2^-35, and full
+ * precision needs a fourth.
+ */
+
+#define RSQRT_MAX_STEPS 3
+
+/* Portable seeds and Newton steps */
+static inline float rsqrtf_seed(float x)
+{
+    uint32_t i;
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5f375a86 - (i >> 1);
+    memcpy(&x, &i, sizeof(x));
+    return x;
+}
+
+static inline double rsqrt_seed(double x)
+{
+    uint64_t i;
+    memcpy(&i, &x, sizeof(i));
+#if defined(__SSE__)
+    /* rsqrtss on x scaled by 4^-k into [1, 4), as in rsqrt_kernel_avx2():
+     * e is the biased exponent, p its parity, q the biased exponent of 2^k.
+     */
+    uint64_t e = i >> 52, p = ~e & 1, q = (e - p + 1023) >> 1;
+    i = (i & 0x000FFFFFFFFFFFFFULL) | (1023 + p) << 52;
+    memcpy(&x, &i, sizeof(x));
+    x = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss((float) x)));
+    memcpy(&i, &x, sizeof(i));
+    i -= (q - 1023) << 52;
+#else
+    i = 0x5fe6eb50c7b537a9ULL - (i >> 1);
+#endif
+    memcpy(&x, &i, sizeof(x));
+    return x;
+}
+
+/* rsqrt of @x after @steps Newton steps from the seed above. */
+static inline float rsqrtf_fast(float x, int steps)
+{
+    float y = rsqrtf_seed(x), half = x * 0.5f;
+    for (int k = 0; k < steps; k++)
+        y = y * (1.5f - half * y * y);
+    return y;
+}
+
+static inline double rsqrt_fast(double x, int steps)
+{
+    double y = rsqrt_seed(x), half = x * 0.5;
+    for (int k = 0; k < steps; k++)
+        y = y * (1.5 - half * y * y);
+    return y;
+}
+
+static inline void rsqrtf_kernel_scalar(const float *in,
+                                        float *out,
+                                        size_t n,
+                                        int steps,
+                                        bool want_sqrt)
+{
+    for (size_t i = 0; i < n; i++) {
+        float x = in[i], y = rsqrtf_fast(x, steps);
+        out[i] = !want_sqrt ? y : x == 0 ? x : x * y;
+    }
+}
+
+static inline void rsqrt_kernel_scalar(const double *in,
+                                       double *out,
+                                       size_t n,
+                                       int steps,
+                                       bool want_sqrt)
+{
+    for (size_t i = 0; i < n; i++) {
+        double x = in[i], y = rsqrt_fast(x, steps);
+        out[i] = !want_sqrt ? y : x == 0 ? x : x * y;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/* Lanes below @left, as a maskload/maskstore mask. */
+__attribute__((target("avx2"))) static inline __m256i rsqrt_tail_mask(
+    size_t left,
+    int lanes)
+{
+    __m256i idx = lanes == 8 ? _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)
+                             : _mm256_setr_epi64x(0, 1, 2, 3);
+    __m256i lim = lanes == 8 ? _mm256_set1_epi32((int) left)
+                             : _mm256_set1_epi64x((long long) left);
+    return lanes == 8 ? _mm256_cmpgt_epi32(lim, idx)
+                      : _mm256_cmpgt_epi64(lim, idx);
+}
+
+__attribute__((target("avx2"))) static inline void rsqrtf_kernel_avx2(
+    const float *in,
+    float *out,
+    size_t n,
+    int steps,
+    bool want_sqrt)
+{
+    const __m256 three_halves = _mm256_set1_ps(1.5f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    for (size_t i = 0; i < n; i += 8) {
+        bool full = n - i >= 8;
+        __m256i lanes = full ? _mm256_set1_epi32(-1)
+                             : rsqrt_tail_mask(n - i, 8);
+        __m256 x = _mm256_maskload_ps(in + i, lanes);
+
+        __m256 y = _mm256_rsqrt_ps(x), h = _mm256_mul_ps(x, half);
+        for (int k = 0; k < steps; k++)
+            y = _mm256_mul_ps(
+                y, _mm256_sub_ps(three_halves,
+                                 _mm256_mul_ps(_mm256_mul_ps(h, y), y)));
+        if (want_sqrt) {
+            __m256 zero = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_EQ_OQ);
+            y = _mm256_blendv_ps(_mm256_mul_ps(x, y), x, zero);
+        }
+        _mm256_maskstore_ps(out + i, lanes, y);
+    }
+}
+
+__attribute__((target("avx2"))) static inline void rsqrt_kernel_avx2(
+    const double *in,
+    double *out,
+    size_t n,
+    int steps,
+    bool want_sqrt)
+{
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i bias = _mm256_set1_epi64x(1023);
+    const __m256i mant = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const __m256d three_halves = _mm256_set1_pd(1.5);
+    const __m256d half = _mm256_set1_pd(0.5);
+
+    for (size_t i = 0; i < n; i += 4) {
+        bool full = n - i >= 4;
+        __m256i lanes = full ? _mm256_set1_epi64x(-1)
+                             : rsqrt_tail_mask(n - i, 4);
+        __m256d x = _mm256_maskload_pd(in + i, lanes);
+
+        /* vrsqrtps on x scaled by 4^-k into [1, 4), where a float holds
+         * it, then times 2^-k. With e the biased exponent, the scaled x
+         * gets exponent 1023 + p, p the parity of e - 1023, and q below is
+         * the biased exponent of 2^k.
+         */
+        __m256i bits = _mm256_castpd_si256(x);
+        __m256i e = _mm256_srli_epi64(bits, 52);
+        __m256i p = _mm256_andnot_si256(e, one);
+        __m256i q = _mm256_srli_epi64(
+            _mm256_add_epi64(_mm256_sub_epi64(e, p), bias), 1);
+        __m256d xr = _mm256_castsi256_pd(_mm256_or_si256(
+            _mm256_and_si256(bits, mant),
+            _mm256_slli_epi64(_mm256_add_epi64(bias, p), 52)));
+        __m256d yr = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(xr)));
+        __m256d y = _mm256_castsi256_pd(
+            _mm256_sub_epi64(_mm256_castpd_si256(yr),
+                             _mm256_slli_epi64(_mm256_sub_epi64(q, bias),
+                                               52)));
+        __m256d h = _mm256_mul_pd(x, half);
+        for (int k = 0; k < steps; k++)
+            y = _mm256_mul_pd(
+                y, _mm256_sub_pd(three_halves,
+                                 _mm256_mul_pd(_mm256_mul_pd(h, y), y)));
+        if (want_sqrt) {
+            __m256d zero = _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ);
+            y = _mm256_blendv_pd(_mm256_mul_pd(x, y), x, zero);
+        }
+        _mm256_maskstore_pd(out + i, lanes, y);
+    }
+}
+
+__attribute__((target("avx512f"))) static inline void rsqrtf_kernel_avx512(
+    const float *in,
+    float *out,
+    size_t n,
+    int steps,
+    bool want_sqrt)
+{
+    const __m512 three_halves = _mm512_set1_ps(1.5f);
+    const __m512 half = _mm512_set1_ps(0.5f);
+
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 lanes = n - i >= 16 ? 0xFFFF : (1u << (n - i)) - 1;
+        __m512 x = _mm512_maskz_loadu_ps(lanes, in + i);
+
+        __m512 y = _mm512_rsqrt14_ps(x), h = _mm512_mul_ps(x, half);
+        for (int k = 0; k < steps; k++)
+            y = _mm512_mul_ps(
+                y, _mm512_sub_ps(three_halves,
+                                 _mm512_mul_ps(_mm512_mul_ps(h, y), y)));
+        if (want_sqrt) {
+            __mmask16 zero =
+                _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_EQ_OQ);
+            y = _mm512_mask_mov_ps(_mm512_mul_ps(x, y), zero, x);
+        }
+        _mm512_mask_storeu_ps(out + i, lanes, y);
+    }
+}
+
+__attribute__((target("avx512f"))) static inline void rsqrt_kernel_avx512(
+    const double *in,
+    double *out,
+    size_t n,
+    int steps,
+    bool want_sqrt)
+{
+    const __m512d three_halves = _mm512_set1_pd(1.5);
+    const __m512d half = _mm512_set1_pd(0.5);
+
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 lanes = n - i >= 8 ? 0xFF : (1u << (n - i)) - 1;
+        __m512d x = _mm512_maskz_loadu_pd(lanes, in + i);
+
+        __m512d y = _mm512_rsqrt14_pd(x), h = _mm512_mul_pd(x, half);
+        for (int k = 0; k < steps; k++)
+            y = _mm512_mul_pd(
+                y, _mm512_sub_pd(three_halves,
+                                 _mm512_mul_pd(_mm512_mul_pd(h, y), y)));
+        if (want_sqrt) {
+            __mmask8 zero =
+                _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_EQ_OQ);
+            y = _mm512_mask_mov_pd(_mm512_mul_pd(x, y), zero, x);
+        }
+        _mm512_mask_storeu_pd(out + i, lanes, y);
+    }
+}
+#endif
+
+typedef void (*rsqrtf_kernel_fn)(const float *, float *, size_t, int, bool);
+typedef void (*rsqrt_kernel_fn)(const double *, double *, size_t, int, bool);
+
+static struct {
+    rsqrtf_kernel_fn f32;
+    rsqrt_kernel_fn f64;
+    const char *name;
+} rsqrt_impl = {rsqrtf_kernel_scalar, rsqrt_kernel_scalar, "scalar"};
+
+__attribute__((constructor)) static void rsqrt_init(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        rsqrt_impl.f32 = rsqrtf_kernel_avx512;
+        rsqrt_impl.f64 = rsqrt_kernel_avx512;
+        rsqrt_impl.name = "AVX-512";
+    } else if (__builtin_cpu_supports("avx2")) {
+        rsqrt_impl.f32 = rsqrtf_kernel_avx2;
+        rsqrt_impl.f64 = rsqrt_kernel_avx2;
+        rsqrt_impl.name = "AVX2";
+    }
+#endif
+}
+
+/**
+ * rsqrtf_array() - out[i] = 1 / sqrt(in[i]) for i < @n
+ * @steps: Newton steps after the estimate, 0 to RSQRT_MAX_STEPS
+ *
+ * Like the other three below, @in and @out may be the same array.
+ */
+static inline void rsqrtf_array(const float *in,
+                                float *out,
+                                size_t n,
+                                int steps)
+{
+    rsqrt_impl.f32(in, out, n, steps, false);
+}
+
+static inline void sqrtf_array(const float *in,
+                               float *out,
+                               size_t n,
+                               int steps)
+{
+    rsqrt_impl.f32(in, out, n, steps, true);
+}
+
+static inline void rsqrt_array(const double *in,
+                               double *out,
+                               size_t n,
+                               int steps)
+{
+    rsqrt_impl.f64(in, out, n, steps, false);
+}
+
+static inline void sqrt_array(const double *in,
+                              double *out,
+                              size_t n,
+                              int steps)
+{
+    rsqrt_impl.f64(in, out, n, steps, true);
+}
@@ -0,0 +1,234 @@
+/* Max ULP error and throughput of rsqrt.h per kernel and Newton step count
+ *
+ * Build: gcc -O2 -o rsqrt_bench rsqrt_bench.c -lm
+ * Usage: ./rsqrt_bench [n] [reps]
+ *
+ * Errors are against 1/sqrt and sqrt in double for float inputs and in long
+ * double for double inputs, in ULPs of the correctly rounded result. Float
+ * inputs are every float in [1, 4), which covers every mantissa at both
+ * exponent parities, plus 2^22 random positive normal floats; double inputs
+ * are 2^24 random doubles in [1, 4) plus 2^22 random positive normal ones.
+ * Then each kernel is timed over @n random inputs, @reps times, next to a
+ * loop over square_root.c's Q_rsqrt(), which always takes three steps.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "qsqrt.h"
+#include "rsqrt.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t rand64(void)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < 4; i++)
+        r = r << 16 ^ (uint64_t) (rand() & 0xFFFF);
+    return r;
+}
+
+enum { SCALAR, AVX2, AVX512 };
+
+static const struct kernel {
+    const char *name;
+    rsqrtf_kernel_fn f32;
+    rsqrt_kernel_fn f64;
+    int isa;
+} kernels[] = {
+    {"scalar", rsqrtf_kernel_scalar, rsqrt_kernel_scalar, SCALAR},
+    {"AVX2", rsqrtf_kernel_avx2, rsqrt_kernel_avx2, AVX2},
+    {"AVX-512", rsqrtf_kernel_avx512, rsqrt_kernel_avx512, AVX512},
+};
+#define NR_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static bool runnable(const struct kernel *k)
+{
+    switch (k->isa) {
+    case AVX2:
+        return __builtin_cpu_supports("avx2");
+    case AVX512:
+        return __builtin_cpu_supports("avx512f");
+    default:
+        return true;
+    }
+}
+
+/* Error of @got in ULPs of the @mant_bits-bit result closest to @want. */
+static inline double ulps(long double got, long double want, int mant_bits)
+{
+    int e;
+    frexpl(want, &e);
+    return fabsl(got - want) / ldexpl(1, e - mant_bits);
+}
+
+#define CHUNK 4096
+
+static double float_error(const struct kernel *k,
+                          const float *in,
+                          size_t n,
+                          int steps,
+                          bool want_sqrt)
+{
+    float out[CHUNK];
+    double worst = 0;
+    for (size_t i = 0; i < n; i += CHUNK) {
+        size_t m = n - i < CHUNK ? n - i : CHUNK;
+        k->f32(in + i, out, m, steps, want_sqrt);
+        for (size_t j = 0; j < m; j++) {
+            double x = in[i + j];
+            double want = want_sqrt ? sqrt(x) : 1 / sqrt(x);
+            double e = ulps(out[j], want, 24);
+            if (e > worst)
+                worst = e;
+        }
+    }
+    return worst;
+}
+
+static double double_error(const struct kernel *k,
+                           const double *in,
+                           size_t n,
+                           int steps,
+                           bool want_sqrt)
+{
+    double out[CHUNK];
+    double worst = 0;
+    for (size_t i = 0; i < n; i += CHUNK) {
+        size_t m = n - i < CHUNK ? n - i : CHUNK;
+        k->f64(in + i, out, m, steps, want_sqrt);
+        for (size_t j = 0; j < m; j++) {
+            long double x = in[i + j];
+            long double want = want_sqrt ? sqrtl(x) : 1 / sqrtl(x);
+            double e = ulps(out[j], want, 53);
+            if (e > worst)
+                worst = e;
+        }
+    }
+    return worst;
+}
+
+static void error_table(void)
+{
+    size_t nf = (3u << 23) + (1u << 22), nd = (1u << 24) + (1u << 22);
+    float *fin = malloc(sizeof(float) * nf);
+    double *din = malloc(sizeof(double) * nd);
+    assert(fin && din);
+
+    size_t n = 0;
+    for (float x = 1; x < 4; x = nextafterf(x, 4))
+        fin[n++] = x;
+    while (n < nf) {
+        uint32_t b = (uint32_t) rand64() & 0x7FFFFFFF;
+        if (b >= 0x00800000 && b < 0x7F800000)
+            memcpy(&fin[n++], &b, sizeof(b));
+    }
+    for (n = 0; n < 1u << 24; n++) {
+        uint64_t b = 0x3FF0000000000000ULL | (rand64() >> 12);
+        memcpy(&din[n], &b, sizeof(b));
+        if (n & 1)
+            din[n] *= 2; /* odd exponent */
+    }
+    while (n < nd) {
+        uint64_t b = rand64() >> 1;
+        if (b >= 0x0010000000000000ULL && b < 0x7FF0000000000000ULL)
+            memcpy(&din[n++], &b, sizeof(b));
+    }
+
+    printf("max error in ULPs, by Newton steps\n");
+    printf("%-22s %10d %10d %10d %10d\n", "", 0, 1, 2, 3);
+    for (int type = 0; type < 4; type++) {
+        bool want_sqrt = type & 1, dbl = type & 2;
+        for (size_t k = 0; k < NR_KERNELS; k++) {
+            if (!runnable(&kernels[k]))
+                continue;
+            char label[32];
+            snprintf(label, sizeof(label), "%s %s %s",
+                     dbl ? "double" : "float", want_sqrt ? "sqrt" : "rsqrt",
+                     kernels[k].name);
+            printf("%-22s", label);
+            for (int s = 0; s <= RSQRT_MAX_STEPS; s++) {
+                double e = dbl ? double_error(&kernels[k], din, nd, s,
+                                              want_sqrt)
+                               : float_error(&kernels[k], fin, nf, s,
+                                             want_sqrt);
+                printf(" %10.3g", e);
+            }
+            printf("\n");
+        }
+    }
+    free(fin);
+    free(din);
+}
+
+static volatile float sink;
+
+static void throughput(size_t n, int reps)
+{
+    float *fin = malloc(sizeof(float) * n), *fout = malloc(sizeof(float) * n);
+    double *din = malloc(sizeof(double) * n);
+    double *dout = malloc(sizeof(double) * n);
+    assert(fin && fout && din && dout);
+    for (size_t i = 0; i < n; i++) {
+        din[i] = ldexp(1 + (double) rand() / RAND_MAX, rand() % 64 - 32);
+        fin[i] = (float) din[i];
+    }
+
+    printf("\n%zu elements x %d reps; rsqrt Melem/s by Newton steps\n", n,
+           reps);
+    printf("%-22s %10d %10d %10d %10d\n", "", 0, 1, 2, 3);
+    double t0 = now();
+    for (int rep = 0; rep < reps; rep++)
+        for (size_t i = 0; i < n; i++)
+            fout[i] = Q_rsqrt(fin[i]);
+    sink = fout[n - 1];
+    printf("%-22s %43.1f\n", "float Q_rsqrt()",
+           (double) n * reps / (now() - t0) / 1e6);
+
+    for (int dbl = 0; dbl < 2; dbl++) {
+        for (size_t k = 0; k < NR_KERNELS; k++) {
+            if (!runnable(&kernels[k]))
+                continue;
+            char label[32];
+            snprintf(label, sizeof(label), "%s %s",
+                     dbl ? "double" : "float", kernels[k].name);
+            printf("%-22s", label);
+            for (int s = 0; s <= RSQRT_MAX_STEPS; s++) {
+                t0 = now();
+                for (int rep = 0; rep < reps; rep++) {
+                    if (dbl)
+                        kernels[k].f64(din, dout, n, s, false);
+                    else
+                        kernels[k].f32(fin, fout, n, s, false);
+                }
+                printf(" %10.1f", (double) n * reps / (now() - t0) / 1e6);
+            }
+            printf("\n");
+        }
+    }
+    printf("%-22s %s\n", "rsqrt_array() uses", rsqrt_impl.name);
+
+    free(fin);
+    free(fout);
+    free(din);
+    free(dout);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 14;
+    int reps = argc > 2 ? atoi(argv[2]) : 1024;
+
+    srand(1);
+    error_table();
+    throughput(n, reps);
+    return 0;
+}
@@ -0,0 +1,357 @@
+/* Every 32-bit input through every square root routine, on all CPUs
+ *
+ * Build: gcc -O2 -pthread -o sqrt_check sqrt_check.c -lm
+ * Usage: ./sqrt_check [threads] [stride]
+ *
+ * sqrti() and sqrti_batch(), floor and ceil, get every uint32_t and must
+ * match the exact integer root; Bi_sqrt() gets every int, must stop and
+ * match it for n >= 0 and must refuse n < 0 (special if it does not).
+ * Q_sqrt() and Q_rsqrt() get every float bit pattern: positive normal
+ * inputs are measured in ULPs against libm computed in double and count as
+ * wrong beyond SQRT_CHECK_MAX_ULPS; zero, denormals, negatives, infinities
+ * and NaN count as special where the result is not what libm gives (NaN for
+ * NaN, the same infinity, or within tolerance).
+ *
+ * The input space is cut into SQRT_CHECK_CHUNK-sized chunks that a tpool
+ * spreads over the threads; each chunk keeps its own counts, merged in
+ * input order at the end, so the examples listed are the smallest failing
+ * inputs. A stride above 1 checks only every stride-th input, for a quick
+ * run. Each routine's sweep is timed, then its single-thread ns/op is
+ * measured on random inputs without the reference.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "qsqrt.h"
+#include "sqrti.h"
+#include "tpool.h"
+
+#ifndef SQRT_CHECK_MAX_ULPS
+#define SQRT_CHECK_MAX_ULPS 4.0
+#endif
+
+#ifndef SQRT_CHECK_CHUNK
+#define SQRT_CHECK_CHUNK (1u << 20)
+#endif
+
+#define NR_CHUNKS ((size_t) ((1ULL << 32) / SQRT_CHECK_CHUNK))
+#define NR_EXAMPLES 6
+
+enum routine {
+    SQRTI_FLOOR,
+    SQRTI_CEIL,
+    BATCH_FLOOR,
+    BATCH_CEIL,
+    BI_SQRT,
+    Q_SQRT,
+    Q_RSQRT,
+    NR_ROUTINES,
+};
+
+static const struct {
+    const char *name;
+    const char *unit; /* of the error */
+} routines[NR_ROUTINES] = {
+    [SQRTI_FLOOR] = {"sqrti", "int"},
+    [SQRTI_CEIL] = {"sqrti ceil", "int"},
+    [BATCH_FLOOR] = {"sqrti_batch", "int"},
+    [BATCH_CEIL] = {"sqrti_batch ceil", "int"},
+    [BI_SQRT] = {"Bi_sqrt", "int"},
+    [Q_SQRT] = {"Q_sqrt", "ULP"},
+    [Q_RSQRT] = {"Q_rsqrt", "ULP"},
+};
+
+struct stats {
+    uint64_t checked; /* inputs in the routine's domain */
+    uint64_t wrong;   /* of those, outside tolerance */
+    uint64_t stuck;   /* of those, did not terminate */
+    uint64_t special; /* outside the domain and unlike libm */
+    double max_err, sum_err;
+    uint32_t max_at;
+    int nbad;
+    uint32_t bad[NR_EXAMPLES]; /* first inputs that failed */
+};
+
+static inline void record(struct stats *s, uint32_t x, double err, bool bad)
+{
+    s->checked++;
+    s->sum_err += err;
+    if (err > s->max_err) {
+        s->max_err = err;
+        s->max_at = x;
+    }
+    if (bad) {
+        s->wrong++;
+        if (s->nbad < NR_EXAMPLES)
+            s->bad[s->nbad++] = x;
+    }
+}
+
+static inline void record_stuck(struct stats *s, uint32_t x)
+{
+    s->stuck++;
+    if (s->nbad < NR_EXAMPLES)
+        s->bad[s->nbad++] = x;
+}
+
+/* Error of @got in ULPs of the float closest to @want. */
+static inline double ulps(double got, double want)
+{
+    int e;
+    frexp(want, &e);
+    return fabs(got - want) / ldexp(1, e - 24);
+}
+
+static inline uint32_t floor_root(uint32_t x)
+{
+    /* Exact: below 2^53 the double root never rounds across an integer. */
+    return (uint32_t) sqrt((double) x);
+}
+
+static void check_float(struct stats *s, uint32_t x, bool rsqrt)
+{
+    float f, got;
+    memcpy(&f, &x, sizeof(f));
+    got = rsqrt ? Q_rsqrt(f) : Q_sqrt(f);
+    double want = rsqrt ? 1 / sqrt((double) f) : sqrt((double) f);
+
+    if (isnormal(f) && f > 0) {
+        double err = isfinite(got) ? ulps(got, want) : INFINITY;
+        record(s, x, err, !(err <= SQRT_CHECK_MAX_ULPS));
+        return;
+    }
+
+    bool same;
+    if (isnan(want))
+        same = isnan(got);
+    else if (isinf(want))
+        same = got == want;
+    else
+        same = isfinite(got) && ulps(got, want) <= SQRT_CHECK_MAX_ULPS;
+    if (!same)
+        s->special++;
+}
+
+static void check_chunk(enum routine r, uint32_t lo, uint32_t stride,
+                        struct stats *s)
+{
+    uint64_t first = (lo + (uint64_t) stride - 1) / stride * stride;
+    uint64_t end = (uint64_t) lo + SQRT_CHECK_CHUNK;
+
+    if (r == BATCH_FLOOR || r == BATCH_CEIL) {
+        uint64_t in[1024], out[1024];
+        bool ceil = r == BATCH_CEIL;
+        for (uint64_t x = first; x < end;) {
+            size_t n = 0;
+            for (; n < 1024 && x < end; x += stride)
+                in[n++] = x;
+            sqrti_batch(in, out, n, ceil);
+            for (size_t i = 0; i < n; i++) {
+                uint64_t want = floor_root((uint32_t) in[i]);
+                want += ceil && want * want != in[i];
+                double err = fabs((double) out[i] - (double) want);
+                record(s, (uint32_t) in[i], err, out[i] != want);
+            }
+        }
+        return;
+    }
+
+    for (uint64_t x = first; x < end; x += stride) {
+        switch (r) {
+        case SQRTI_FLOOR:
+        case SQRTI_CEIL: {
+            bool ceil = r == SQRTI_CEIL;
+            uint64_t got = sqrti(x, ceil), want = floor_root((uint32_t) x);
+            want += ceil && want * want != x;
+            record(s, (uint32_t) x, fabs((double) got - (double) want),
+                   got != want);
+            break;
+        }
+        case BI_SQRT: {
+            int n = (int) (int32_t) (uint32_t) x;
+            int32_t got = Bi_sqrt(n);
+            if (n < 0)
+                s->special += got != BI_SQRT_FAILED;
+            else if (got == BI_SQRT_FAILED)
+                record_stuck(s, (uint32_t) x);
+            else {
+                uint32_t want = floor_root((uint32_t) n);
+                record(s, (uint32_t) x, fabs((double) got - want),
+                       (uint32_t) got != want);
+            }
+            break;
+        }
+        case Q_SQRT:
+        case Q_RSQRT:
+            check_float(s, (uint32_t) x, r == Q_RSQRT);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+struct sweep {
+    enum routine r;
+    uint32_t stride;
+    struct stats *chunks; /* one per chunk */
+};
+
+struct sweep_job {
+    struct sweep *sw;
+    size_t lo, hi; /* chunk numbers */
+};
+
+static void sweep_run(void *arg)
+{
+    struct sweep_job *job = arg;
+    if (job->hi - job->lo > 1) {
+        size_t mid = job->lo + (job->hi - job->lo) / 2;
+        struct sweep_job left = {job->sw, job->lo, mid};
+        struct sweep_job right = {job->sw, mid, job->hi};
+        task_t t;
+        tpool_spawn(&t, sweep_run, &left);
+        sweep_run(&right);
+        tpool_sync(&t);
+        return;
+    }
+    check_chunk(job->sw->r, (uint32_t) (job->lo * SQRT_CHECK_CHUNK),
+                job->sw->stride, &job->sw->chunks[job->lo]);
+}
+
+static struct stats merge(const struct stats *chunks)
+{
+    struct stats t = {0};
+    for (size_t c = 0; c < NR_CHUNKS; c++) {
+        const struct stats *s = &chunks[c];
+        t.checked += s->checked;
+        t.wrong += s->wrong;
+        t.stuck += s->stuck;
+        t.special += s->special;
+        t.sum_err += s->sum_err;
+        if (s->max_err > t.max_err) {
+            t.max_err = s->max_err;
+            t.max_at = s->max_at;
+        }
+        for (int i = 0; i < s->nbad && t.nbad < NR_EXAMPLES; i++)
+            t.bad[t.nbad++] = s->bad[i];
+    }
+    return t;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static volatile uint64_t sink;
+
+/* Single-thread ns per call on random inputs, without any checking. */
+static double time_routine(enum routine r, const uint32_t *in, size_t n)
+{
+    static uint64_t wide[1 << 12], out[1 << 12];
+    uint64_t acc = 0;
+    double t0 = now();
+    switch (r) {
+    case SQRTI_FLOOR:
+    case SQRTI_CEIL:
+        for (size_t i = 0; i < n; i++)
+            acc += sqrti(in[i], r == SQRTI_CEIL);
+        break;
+    case BATCH_FLOOR:
+    case BATCH_CEIL:
+        for (size_t i = 0; i < n; i += 1 << 12) {
+            size_t m = n - i < 1 << 12 ? n - i : 1 << 12;
+            for (size_t j = 0; j < m; j++)
+                wide[j] = in[i + j];
+            sqrti_batch(wide, out, m, r == BATCH_CEIL);
+            acc += out[0];
+        }
+        break;
+    case BI_SQRT:
+        for (size_t i = 0; i < n; i++)
+            acc += Bi_sqrt((int) (in[i] >> 1));
+        break;
+    case Q_SQRT:
+    case Q_RSQRT:
+        for (size_t i = 0; i < n; i++) {
+            float f = (float) (in[i] >> 8) + 1;
+            float y = r == Q_SQRT ? Q_sqrt(f) : Q_rsqrt(f);
+            acc += (uint64_t) (y * 1e6f);
+        }
+        break;
+    default:
+        break;
+    }
+    sink = acc;
+    return (now() - t0) * 1e9 / n;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    uint32_t stride = argc > 2 ? (uint32_t) strtoul(argv[2], NULL, 10) : 1;
+    if (!stride)
+        stride = 1;
+
+    struct tpool *pool = tpool_create(threads);
+    struct stats *chunks = malloc(sizeof(struct stats) * NR_CHUNKS);
+    size_t ntime = 1 << 22;
+    uint32_t *in = malloc(sizeof(uint32_t) * ntime);
+    assert(pool && chunks && in);
+    srand(1);
+    for (size_t i = 0; i < ntime; i++)
+        in[i] = (uint32_t) rand() << 16 ^ (uint32_t) rand();
+
+    printf("%d threads, 2^32 inputs at stride %u; sqrti_batch() uses %s\n",
+           pool->nthreads, stride, sqrti_batch_impl.name);
+    printf("%-16s %10s %8s %7s %10s %9s %12s %9s %4s %7s %7s\n", "routine",
+           "checked", "wrong", "no-stop", "special", "max err", "at",
+           "mean err", "", "sweep s", "ns/op");
+
+    struct stats totals[NR_ROUTINES];
+    bool all_ok = true;
+    for (int r = 0; r < NR_ROUTINES; r++) {
+        memset(chunks, 0, sizeof(struct stats) * NR_CHUNKS);
+        struct sweep sw = {r, stride, chunks};
+        struct sweep_job root = {&sw, 0, NR_CHUNKS};
+        double t0 = now();
+        tpool_run(pool, sweep_run, &root);
+        double t_sweep = now() - t0;
+
+        struct stats t = totals[r] = merge(chunks);
+        double ns = time_routine(r, in, ntime);
+        printf("%-16s %10lu %8lu %7lu %10lu %9.3g %#12x %9.3g %4s %7.1f "
+               "%7.2f\n",
+               routines[r].name, (unsigned long) t.checked,
+               (unsigned long) t.wrong, (unsigned long) t.stuck,
+               (unsigned long) t.special, t.max_err, t.max_at,
+               t.checked ? t.sum_err / t.checked : 0.0, routines[r].unit,
+               t_sweep, ns);
+        fflush(stdout);
+        if (t.wrong || t.stuck)
+            all_ok = false;
+    }
+
+    for (int r = 0; r < NR_ROUTINES; r++) {
+        const struct stats *t = &totals[r];
+        if (!t->nbad)
+            continue;
+        printf("%s fails on", routines[r].name);
+        for (int i = 0; i < t->nbad; i++)
+            printf(" %#x", t->bad[i]);
+        printf("%s\n", t->wrong + t->stuck > (uint64_t) t->nbad ? " ..." : "");
+    }
+
+    tpool_print_stats(pool, "sqrt_check");
+    tpool_destroy(pool);
+    free(chunks);
+    free(in);
+    return all_ok ? 0 : 1;
+}
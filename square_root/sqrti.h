@@ -0,0 +1,226 @@
+/* Integer square roots of uint64_t, one at a time or over whole arrays */
+
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "bitops.h"
+
+/**
+ * Usage:
+ *
+ *   uint64_t r = sqrti(x, false);            // floor(sqrt(x))
+ *   sqrti_batch(in, out, n, true);           // ceil, for every element
+ *
+ * sqrti() finds the root one bit per iteration, up to 32 of them, with
+ * integer arithmetic only. sqrti_batch() gives bit-identical results for
+ * every input but starts from the hardware double-precision square root:
+ *
+ *   x converts to double with a relative error of at most 2^-53, and the
+ *   square root halves that, so for x < 2^64 the estimate is within 2^-20 of
+ *   sqrt(x). Truncated, it is floor(sqrt(x)) or one off either way: above
+ *   2^53, where x itself no longer fits a double, as much as below, where the
+ *   estimate can still round up across an integer (x = k^2 - 1, large k).
+ *   One exact integer step fixes that: y * y > x means one too many, and
+ *   x - y * y > 2y, i.e. (y + 1)^2 <= x, one too few. Since y < 2^32 the
+ *   square is a single 32x32->64 multiply, which SIMD has (vpmuludq); the
+ *   estimate is clamped to 2^32 - 1 because x close to 2^64 rounds up to
+ *   exactly 2^64.
+ *
+ * Kernels exist for AVX-512 (F + DQ: 8 lanes, native uint64<->double
+ * conversions and masked tails), AVX2 (4 lanes, conversions through the
+ * exponent-bias trick) and plain C; sqrti_batch() calls the best one this
+ * CPU supports, chosen by sqrti_batch_init() before main() runs.
+ */
+
+static inline uint64_t sqrti(uint64_t x, bool if_ceil)
+{
+    uint64_t m, y = 0;
+    if (x <= 1)
+        return x;
+
+    /* ilog2_64(x) is the index of the highest set bit. Rounding it down to
+     * an even number ensures our starting m is a power of 4.
+     */
+    int shift = ilog2_64(x) & ~1;
+    m = 1ULL << shift;
+
+    while (m) {
+        uint64_t b = y + m;
+        y >>= 1;
+        if (x >= b) {
+            x -= b;
+            y += m;
+        }
+        m >>= 2;
+    }
+
+    if (if_ceil)
+        return x != 0 ? y + 1 : y;
+    return y;
+}
+
+/* sqrt() without libm's errno path, so includers need no -lm. */
+static inline double sqrti_sqrt(double x)
+{
+#if defined(__SSE2__)
+    return _mm_cvtsd_f64(_mm_sqrt_sd(_mm_setzero_pd(), _mm_set_sd(x)));
+#else
+    return sqrt(x);
+#endif
+}
+
+/* sqrti() from a double estimate and one correction step. */
+static inline uint64_t sqrti_fast(uint64_t x, bool if_ceil)
+{
+    uint64_t y = (uint64_t) sqrti_sqrt((double) x);
+    if (y > 0xFFFFFFFF)
+        y = 0xFFFFFFFF;
+    if (y * y > x)
+        y--;
+    else if (x - y * y > 2 * y)
+        y++;
+    return y + (if_ceil && y * y != x);
+}
+
+static inline void sqrti_batch_scalar(const uint64_t *in,
+                                      uint64_t *out,
+                                      size_t n,
+                                      bool if_ceil)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = sqrti_fast(in[i], if_ceil);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static inline void sqrti_batch_avx2(
+    const uint64_t *in,
+    uint64_t *out,
+    size_t n,
+    bool if_ceil)
+{
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256d two52 = _mm256_set1_pd(0x1p52);
+    const __m256d two84 = _mm256_set1_pd(0x1p84);
+    const __m256d two84_52 = _mm256_set1_pd(0x1p84 + 0x1p52);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (in + i));
+
+        /* (double) x as hi * 2^32 + lo: put each half in the mantissa of
+         * 2^84 and 2^52, subtract the biases, add.
+         */
+        __m256i hi = _mm256_or_si256(_mm256_srli_epi64(x, 32),
+                                     _mm256_castpd_si256(two84));
+        __m256i lo =
+            _mm256_blend_epi32(x, _mm256_castpd_si256(two52), 0xAA);
+        __m256d d = _mm256_add_pd(
+            _mm256_sub_pd(_mm256_castsi256_pd(hi), two84_52),
+            _mm256_castsi256_pd(lo));
+
+        /* Truncated root, at most 2^32, back through the 2^52 mantissa;
+         * y - (y >> 32) turns 2^32 into 2^32 - 1.
+         */
+        d = _mm256_round_pd(_mm256_sqrt_pd(d),
+                            _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        __m256i y = _mm256_xor_si256(
+            _mm256_castpd_si256(_mm256_add_pd(d, two52)),
+            _mm256_castpd_si256(two52));
+        y = _mm256_sub_epi64(y, _mm256_srli_epi64(y, 32));
+
+        /* AVX2 compares are signed; flipping the sign bit makes them
+         * unsigned. The masks are all ones, i.e. -1, where true.
+         */
+        __m256i xs = _mm256_xor_si256(x, sign);
+        __m256i sq = _mm256_mul_epu32(y, y);
+        __m256i over = _mm256_cmpgt_epi64(_mm256_xor_si256(sq, sign), xs);
+        y = _mm256_add_epi64(y, over);
+
+        sq = _mm256_mul_epu32(y, y);
+        __m256i rem = _mm256_xor_si256(_mm256_sub_epi64(x, sq), sign);
+        __m256i twice = _mm256_xor_si256(_mm256_add_epi64(y, y), sign);
+        y = _mm256_sub_epi64(y, _mm256_cmpgt_epi64(rem, twice));
+
+        if (if_ceil) {
+            __m256i exact = _mm256_cmpeq_epi64(_mm256_mul_epu32(y, y), x);
+            y = _mm256_add_epi64(y, _mm256_add_epi64(one, exact));
+        }
+        _mm256_storeu_si256((__m256i *) (out + i), y);
+    }
+    sqrti_batch_scalar(in + i, out + i, n - i, if_ceil);
+}
+
+__attribute__((target("avx512f,avx512dq"))) static inline void
+sqrti_batch_avx512(const uint64_t *in, uint64_t *out, size_t n, bool if_ceil)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i max = _mm512_set1_epi64(0xFFFFFFFF);
+
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 lanes = n - i >= 8 ? 0xFF : (1u << (n - i)) - 1;
+        __m512i x = _mm512_maskz_loadu_epi64(lanes, in + i);
+
+        __m512d d = _mm512_sqrt_pd(_mm512_cvtepu64_pd(x));
+        __m512i y = _mm512_min_epu64(_mm512_cvttpd_epu64(d), max);
+
+        __m512i sq = _mm512_mul_epu32(y, y);
+        __mmask8 m = _mm512_cmpgt_epu64_mask(sq, x);
+        y = _mm512_mask_sub_epi64(y, m, y, one);
+
+        sq = _mm512_mul_epu32(y, y);
+        m = _mm512_cmpgt_epu64_mask(_mm512_sub_epi64(x, sq),
+                                    _mm512_add_epi64(y, y));
+        y = _mm512_mask_add_epi64(y, m, y, one);
+
+        if (if_ceil) {
+            m = _mm512_cmpneq_epu64_mask(_mm512_mul_epu32(y, y), x);
+            y = _mm512_mask_add_epi64(y, m, y, one);
+        }
+        _mm512_mask_storeu_epi64(out + i, lanes, y);
+    }
+}
+#endif
+
+typedef void (*sqrti_batch_fn)(const uint64_t *, uint64_t *, size_t, bool);
+
+static struct {
+    sqrti_batch_fn fn;
+    const char *name;
+} sqrti_batch_impl = {sqrti_batch_scalar, "scalar"};
+
+__attribute__((constructor)) static void sqrti_batch_init(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512dq")) {
+        sqrti_batch_impl.fn = sqrti_batch_avx512;
+        sqrti_batch_impl.name = "AVX-512";
+    } else if (__builtin_cpu_supports("avx2")) {
+        sqrti_batch_impl.fn = sqrti_batch_avx2;
+        sqrti_batch_impl.name = "AVX2";
+    }
+#endif
+}
+
+/**
+ * sqrti_batch() - out[i] = sqrti(in[i], @if_ceil) for i < @n
+ *
+ * @in and @out may be the same array, but must not otherwise overlap.
+ */
+static inline void sqrti_batch(const uint64_t *in,
+                               uint64_t *out,
+                               size_t n,
+                               bool if_ceil)
+{
+    sqrti_batch_impl.fn(in, out, n, if_ceil);
+}
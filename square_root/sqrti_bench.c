@@ -0,0 +1,182 @@
+/* sqrti_batch() against sqrti(): bit-exactness, then elements per second
+ *
+ * Build: gcc -O2 -o sqrti_bench sqrti_bench.c
+ * Usage: ./sqrti_bench [n] [reps]
+ *
+ * Every kernel the CPU can run is compared with sqrti(), floor and ceil, on
+ * all inputs below 2^20, on k^2 - 1, k^2 and k^2 + 1 for k on both sides of
+ * 2^26.5 (where doubles start rounding k^2 - 1 up to k^2) and up to
+ * 2^32 - 1, around 2^53 and 2^64, and on random inputs of every width. Then
+ * each is timed over @n random inputs, @reps times.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sqrti.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t rand64(void)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < 4; i++)
+        r = r << 16 ^ (uint64_t) (rand() & 0xFFFF);
+    return r;
+}
+
+enum { SCALAR, AVX2, AVX512 };
+
+static const struct kernel {
+    const char *name;
+    sqrti_batch_fn fn;
+    int isa;
+} kernels[] = {
+    {"scalar", sqrti_batch_scalar, SCALAR},
+    {"AVX2", sqrti_batch_avx2, AVX2},
+    {"AVX-512", sqrti_batch_avx512, AVX512},
+};
+#define NR_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static bool runnable(const struct kernel *k)
+{
+    switch (k->isa) {
+    case AVX2:
+        return __builtin_cpu_supports("avx2");
+    case AVX512:
+        return __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512dq");
+    default:
+        return true;
+    }
+}
+
+/* Compare every runnable kernel with sqrti() on in[0..n). */
+static void check(const uint64_t *in, size_t n, uint64_t *out)
+{
+    for (int ceil = 0; ceil < 2; ceil++) {
+        for (size_t k = 0; k < NR_KERNELS; k++) {
+            if (!runnable(&kernels[k]))
+                continue;
+            kernels[k].fn(in, out, n, ceil);
+            for (size_t i = 0; i < n; i++) {
+                uint64_t want = sqrti(in[i], ceil);
+                if (out[i] == want)
+                    continue;
+                fprintf(stderr, "%s: sqrti(%lu, %d) = %lu, got %lu\n",
+                        kernels[k].name, (unsigned long) in[i], ceil,
+                        (unsigned long) want, (unsigned long) out[i]);
+                exit(1);
+            }
+        }
+    }
+}
+
+static void run_checks(void)
+{
+    size_t cap = 1 << 20, n = 0;
+    uint64_t *in = malloc(sizeof(uint64_t) * cap);
+    uint64_t *out = malloc(sizeof(uint64_t) * cap);
+    assert(in && out);
+
+#define FLUSH()                  \
+    do {                         \
+        check(in, n, out);       \
+        n = 0;                   \
+    } while (0)
+#define ADD(v)                   \
+    do {                         \
+        in[n++] = (v);           \
+        if (n == cap)            \
+            FLUSH();             \
+    } while (0)
+
+    for (uint64_t x = 0; x < 1 << 20; x++)
+        ADD(x);
+    FLUSH();
+
+    /* Squares and their neighbours, bounded so k^2 + 1 fits. */
+    uint64_t ks[] = {1, 94906265 - 100000, 1ULL << 31, 0xFFFFFFFF - 100000};
+    for (int r = 0; r < 4; r++)
+        for (uint64_t k = ks[r]; k < ks[r] + 100000; k++) {
+            ADD(k * k - 1);
+            ADD(k * k);
+            if (k * k + 1)
+                ADD(k * k + 1);
+        }
+    for (int i = 0; i < 1 << 18; i++) {
+        uint64_t k = (rand64() >> 32) | 1;
+        ADD(k * k - 1);
+        ADD(k * k);
+        ADD(k * k + 1);
+    }
+
+    /* Around 2^53, where uint64 stops fitting a double, and around 2^64. */
+    for (uint64_t d = 0; d < 1 << 16; d++) {
+        ADD((1ULL << 53) - d);
+        ADD((1ULL << 53) + d);
+        ADD(UINT64_MAX - d);
+    }
+
+    /* Random inputs of every width. */
+    for (int i = 0; i < 1 << 22; i++)
+        ADD(rand64() >> (i & 63));
+    FLUSH();
+
+    free(in);
+    free(out);
+    printf("checks passed\n");
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 16;
+    int reps = argc > 2 ? atoi(argv[2]) : 256;
+
+    srand(1);
+    run_checks();
+
+    uint64_t *in = malloc(sizeof(uint64_t) * n);
+    uint64_t *out = malloc(sizeof(uint64_t) * n);
+    assert(in && out);
+    for (size_t i = 0; i < n; i++)
+        in[i] = rand64() >> (rand() & 63);
+
+    printf("sqrti_batch() uses %s; %zu elements x %d reps\n",
+           sqrti_batch_impl.name, n, reps);
+    printf("%-14s %14s %14s\n", "", "floor Melem/s", "ceil Melem/s");
+
+    double rate[2];
+    for (int ceil = 0; ceil < 2; ceil++) {
+        int r = reps / 64 ? reps / 64 : 1; /* the loop is slow */
+        double t0 = now();
+        for (int rep = 0; rep < r; rep++)
+            for (size_t i = 0; i < n; i++)
+                out[i] = sqrti(in[i], ceil);
+        rate[ceil] = (double) n * r / (now() - t0) / 1e6;
+    }
+    printf("%-14s %14.1f %14.1f\n", "sqrti() loop", rate[0], rate[1]);
+
+    for (size_t k = 0; k < NR_KERNELS; k++) {
+        if (!runnable(&kernels[k]))
+            continue;
+        for (int ceil = 0; ceil < 2; ceil++) {
+            double t0 = now();
+            for (int rep = 0; rep < reps; rep++)
+                kernels[k].fn(in, out, n, ceil);
+            rate[ceil] = (double) n * reps / (now() - t0) / 1e6;
+        }
+        printf("%-14s %14.1f %14.1f\n", kernels[k].name, rate[0], rate[1]);
+    }
+
+    free(in);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,470 @@
+/* Concurrent int -> long hash map: lock-free reads, striped-lock writes */
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "map.h"
+
+/**
+ * cmap_t - a map_t variant that one index can share across threads
+ *
+ * Usage:
+ *
+ *   cmap_t *map = cmap_init(10);
+ *   struct cmap_thread *self = cmap_thread_register(map);  // per thread
+ *   cmap_add(map, self, key, value);
+ *   if (cmap_get(map, self, key, &value)) ...
+ *   cmap_del(map, self, key);
+ *   cmap_thread_unregister(map, self);
+ *   cmap_deinit(map);                                      // once all left
+ *
+ * Readers never take a lock. Chains are singly linked through atomic next
+ * pointers; a writer fully initialises a node before publishing it with a
+ * release store, and readers follow the links with acquire loads, so they
+ * always see a consistent node. Values are stored inline and copied out,
+ * which keeps a reader from holding a pointer into a node after it returns.
+ *
+ * Writers serialise per stripe of buckets with a spinlock, so find-then-
+ * insert is atomic for a given key while writers on other stripes proceed in
+ * parallel. Growing takes every stripe lock, copies the entries into a new
+ * table and publishes it; readers keep walking whichever table they loaded.
+ *
+ * Unlinked nodes and replaced tables cannot be freed while a reader may
+ * still be on them, so they are retired with epoch-based reclamation. Each
+ * operation announces the global epoch in its thread record for as long as
+ * it touches the map. The epoch only advances once every active thread has
+ * announced the current one, so anything retired in epoch e is unreachable
+ * to all threads by the time the global epoch reaches e + 2.
+ */
+
+#ifndef CMAP_STRIPES
+#define CMAP_STRIPES 64 /* must be a power of two */
+#endif
+
+#ifndef CMAP_MAX_THREADS
+#define CMAP_MAX_THREADS 64
+#endif
+
+/* Retired objects a thread accumulates before it tries to reclaim. */
+#ifndef CMAP_RECLAIM_BATCH
+#define CMAP_RECLAIM_BATCH 64
+#endif
+
+struct cmap_node {
+    int key;
+    long value;
+    _Atomic(struct cmap_node *) next;
+    union {
+        _Atomic(struct cmap_node *) *pprev; /* while linked, writers only */
+        struct cmap_node *retired_next;     /* once retired */
+    };
+    unsigned long retired_epoch;
+};
+
+struct cmap_table {
+    int bits;
+    struct cmap_table *retired_next;
+    unsigned long retired_epoch;
+    _Atomic(struct cmap_node *) heads[];
+};
+
+struct cmap_thread {
+    atomic_ulong epoch; /* 0 while outside the map */
+    atomic_bool used;
+    struct cmap_node *retired;
+    size_t nretired;
+    struct cmap_table *retired_tables;
+} __attribute__((aligned(64)));
+
+struct cmap_lock {
+    atomic_int locked;
+} __attribute__((aligned(64)));
+
+typedef struct {
+    _Atomic(struct cmap_table *) table;
+    atomic_size_t count;
+    atomic_ulong epoch;
+    struct cmap_lock stripes[CMAP_STRIPES];
+    struct cmap_thread threads[CMAP_MAX_THREADS];
+
+    /* Registration, and retired objects left behind by departed threads. */
+    pthread_mutex_t lock;
+    struct cmap_node *orphans;
+    struct cmap_table *orphan_tables;
+} cmap_t;
+
+static inline void cmap_lock(struct cmap_lock *l)
+{
+    for (int spins = 0;; spins++) {
+        if (!atomic_load_explicit(&l->locked, memory_order_relaxed) &&
+            !atomic_exchange_explicit(&l->locked, 1, memory_order_acquire))
+            return;
+        if (spins >= 64) /* the holder may be preempted */
+            sched_yield();
+    }
+}
+
+static inline void cmap_unlock(struct cmap_lock *l)
+{
+    atomic_store_explicit(&l->locked, 0, memory_order_release);
+}
+
+static inline struct cmap_table *cmap_table_alloc(int bits)
+{
+    size_t heads = sizeof(_Atomic(struct cmap_node *)) * MAP_HASH_SIZE(bits);
+    struct cmap_table *t = calloc(1, sizeof(struct cmap_table) + heads);
+    if (t)
+        t->bits = bits;
+    return t;
+}
+
+/* Free @t together with the nodes still linked into it. */
+static inline void cmap_table_free(struct cmap_table *t)
+{
+    for (int i = 0; i < MAP_HASH_SIZE(t->bits); i++) {
+        struct cmap_node *p = atomic_load_explicit(&t->heads[i],
+                                                   memory_order_relaxed);
+        while (p) {
+            struct cmap_node *next =
+                atomic_load_explicit(&p->next, memory_order_relaxed);
+            free(p);
+            p = next;
+        }
+    }
+    free(t);
+}
+
+static inline cmap_t *cmap_init(int bits)
+{
+    cmap_t *map;
+    if (posix_memalign((void **) &map, 64, sizeof(cmap_t)))
+        return NULL;
+
+    struct cmap_table *t = cmap_table_alloc(bits);
+    if (!t) {
+        free(map);
+        return NULL;
+    }
+    atomic_init(&map->table, t);
+    atomic_init(&map->count, 0);
+    atomic_init(&map->epoch, 1);
+    for (int i = 0; i < CMAP_STRIPES; i++)
+        atomic_init(&map->stripes[i].locked, 0);
+    for (int i = 0; i < CMAP_MAX_THREADS; i++) {
+        struct cmap_thread *th = &map->threads[i];
+        atomic_init(&th->epoch, 0);
+        atomic_init(&th->used, false);
+        th->retired = NULL;
+        th->nretired = 0;
+        th->retired_tables = NULL;
+    }
+    pthread_mutex_init(&map->lock, NULL);
+    map->orphans = NULL;
+    map->orphan_tables = NULL;
+    return map;
+}
+
+/* Claim a thread record; NULL when CMAP_MAX_THREADS are registered. */
+static inline struct cmap_thread *cmap_thread_register(cmap_t *map)
+{
+    struct cmap_thread *self = NULL;
+
+    pthread_mutex_lock(&map->lock);
+    for (int i = 0; i < CMAP_MAX_THREADS && !self; i++) {
+        if (!atomic_load_explicit(&map->threads[i].used,
+                                  memory_order_relaxed)) {
+            self = &map->threads[i];
+            atomic_store_explicit(&self->used, true, memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&map->lock);
+    return self;
+}
+
+static inline void cmap_enter(cmap_t *map, struct cmap_thread *self)
+{
+    atomic_store_explicit(&self->epoch, atomic_load(&map->epoch),
+                          memory_order_relaxed);
+    /* The announcement must be visible before any table or chain load. */
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+static inline void cmap_leave(struct cmap_thread *self)
+{
+    atomic_store_explicit(&self->epoch, 0, memory_order_release);
+}
+
+/* Advance the global epoch if every active thread has caught up with it. */
+static inline unsigned long cmap_try_advance(cmap_t *map)
+{
+    /* Pairs with cmap_enter(): order earlier unlinks before the scan. */
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned long e = atomic_load(&map->epoch);
+
+    for (int i = 0; i < CMAP_MAX_THREADS; i++) {
+        unsigned long seen = atomic_load(&map->threads[i].epoch);
+        if (seen && seen != e)
+            return e;
+    }
+    if (atomic_compare_exchange_strong(&map->epoch, &e, e + 1))
+        return e + 1;
+    return e; /* someone else advanced it */
+}
+
+/* Free what @self retired at least two epochs before @epoch. */
+static inline void cmap_reclaim(struct cmap_thread *self, unsigned long epoch)
+{
+    /* Both lists are newest first, so everything past the cut is old too. */
+    struct cmap_node **pn = &self->retired;
+    while (*pn && (*pn)->retired_epoch + 2 > epoch)
+        pn = &(*pn)->retired_next;
+    for (struct cmap_node *p = *pn, *next; p; p = next) {
+        next = p->retired_next;
+        free(p);
+        self->nretired--;
+    }
+    *pn = NULL;
+
+    struct cmap_table **pt = &self->retired_tables;
+    while (*pt && (*pt)->retired_epoch + 2 > epoch)
+        pt = &(*pt)->retired_next;
+    for (struct cmap_table *t = *pt, *next; t; t = next) {
+        next = t->retired_next;
+        cmap_table_free(t);
+    }
+    *pt = NULL;
+}
+
+static inline void cmap_retire(cmap_t *map,
+                               struct cmap_thread *self,
+                               struct cmap_node *n)
+{
+    n->retired_epoch = atomic_load(&map->epoch);
+    n->retired_next = self->retired;
+    self->retired = n;
+    if (++self->nretired >= CMAP_RECLAIM_BATCH)
+        cmap_reclaim(self, cmap_try_advance(map));
+}
+
+/* Give up @self; whatever it could not reclaim yet goes to the map. */
+static inline void cmap_thread_unregister(cmap_t *map,
+                                          struct cmap_thread *self)
+{
+    cmap_reclaim(self, cmap_try_advance(map));
+
+    pthread_mutex_lock(&map->lock);
+    while (self->retired) {
+        struct cmap_node *n = self->retired;
+        self->retired = n->retired_next;
+        n->retired_next = map->orphans;
+        map->orphans = n;
+    }
+    while (self->retired_tables) {
+        struct cmap_table *t = self->retired_tables;
+        self->retired_tables = t->retired_next;
+        t->retired_next = map->orphan_tables;
+        map->orphan_tables = t;
+    }
+    self->nretired = 0;
+    atomic_store_explicit(&self->used, false, memory_order_relaxed);
+    pthread_mutex_unlock(&map->lock);
+}
+
+static inline bool cmap_get(cmap_t *map,
+                            struct cmap_thread *self,
+                            int key,
+                            long *value)
+{
+    bool found = false;
+
+    cmap_enter(map, self);
+    struct cmap_table *t =
+        atomic_load_explicit(&map->table, memory_order_acquire);
+    struct cmap_node *p = atomic_load_explicit(
+        &t->heads[hash(key, t->bits)], memory_order_acquire);
+    for (; p; p = atomic_load_explicit(&p->next, memory_order_acquire)) {
+        if (p->key == key) {
+            *value = p->value;
+            found = true;
+            break;
+        }
+    }
+    cmap_leave(self);
+    return found;
+}
+
+/* Lock the stripe of @key's bucket in the current table, and return both. */
+static inline struct cmap_table *cmap_lock_bucket(cmap_t *map,
+                                                  int key,
+                                                  struct cmap_lock **lock,
+                                                  size_t *bucket)
+{
+    for (;;) {
+        struct cmap_table *t =
+            atomic_load_explicit(&map->table, memory_order_acquire);
+        *bucket = hash(key, t->bits);
+        *lock = &map->stripes[*bucket & (CMAP_STRIPES - 1)];
+        cmap_lock(*lock);
+        /* A grow publishes its table while holding every stripe. */
+        if (atomic_load_explicit(&map->table, memory_order_relaxed) == t)
+            return t;
+        cmap_unlock(*lock);
+    }
+}
+
+/* Double the table under all stripe locks, unless @seen was replaced. */
+static inline void cmap_grow(cmap_t *map,
+                             struct cmap_thread *self,
+                             struct cmap_table *seen)
+{
+    if (seen->bits >= MAP_MAX_BITS)
+        return;
+
+    for (int i = 0; i < CMAP_STRIPES; i++)
+        cmap_lock(&map->stripes[i]);
+
+    struct cmap_table *old =
+        atomic_load_explicit(&map->table, memory_order_relaxed);
+    struct cmap_table *t = old == seen ? cmap_table_alloc(old->bits + 1) : NULL;
+    if (t) {
+        /* Readers may be on the old chains, so copy rather than relink. */
+        for (int i = 0; i < MAP_HASH_SIZE(old->bits); i++) {
+            struct cmap_node *p =
+                atomic_load_explicit(&old->heads[i], memory_order_relaxed);
+            for (; p;
+                 p = atomic_load_explicit(&p->next, memory_order_relaxed)) {
+                struct cmap_node *n = malloc(sizeof(struct cmap_node));
+                if (!n)
+                    abort();
+                _Atomic(struct cmap_node *) *head =
+                    &t->heads[hash(p->key, t->bits)];
+                struct cmap_node *first =
+                    atomic_load_explicit(head, memory_order_relaxed);
+                n->key = p->key;
+                n->value = p->value;
+                atomic_init(&n->next, first);
+                n->pprev = head;
+                if (first)
+                    first->pprev = &n->next;
+                atomic_store_explicit(head, n, memory_order_relaxed);
+            }
+        }
+        atomic_store_explicit(&map->table, t, memory_order_release);
+    }
+
+    for (int i = CMAP_STRIPES - 1; i >= 0; i--)
+        cmap_unlock(&map->stripes[i]);
+
+    if (t) {
+        old->retired_epoch = atomic_load(&map->epoch);
+        old->retired_next = self->retired_tables;
+        self->retired_tables = old;
+        cmap_reclaim(self, cmap_try_advance(map));
+    }
+}
+
+/* Insert @key -> @value unless @key is present; true if it was inserted. */
+static inline bool cmap_add(cmap_t *map,
+                            struct cmap_thread *self,
+                            int key,
+                            long value)
+{
+    struct cmap_lock *lock;
+    size_t b;
+
+    cmap_enter(map, self);
+    struct cmap_table *t = cmap_lock_bucket(map, key, &lock, &b);
+
+    _Atomic(struct cmap_node *) *head = &t->heads[b];
+    struct cmap_node *first = atomic_load_explicit(head, memory_order_relaxed);
+    for (struct cmap_node *p = first; p;
+         p = atomic_load_explicit(&p->next, memory_order_relaxed)) {
+        if (p->key == key) {
+            cmap_unlock(lock);
+            cmap_leave(self);
+            return false;
+        }
+    }
+
+    struct cmap_node *n = malloc(sizeof(struct cmap_node));
+    if (!n) {
+        cmap_unlock(lock);
+        cmap_leave(self);
+        return false;
+    }
+    n->key = key;
+    n->value = value;
+    atomic_init(&n->next, first);
+    n->pprev = head;
+    if (first)
+        first->pprev = &n->next;
+    atomic_store_explicit(head, n, memory_order_release);
+    cmap_unlock(lock);
+
+    size_t count = atomic_fetch_add_explicit(&map->count, 1,
+                                             memory_order_relaxed) + 1;
+    if (count > (size_t) MAP_HASH_SIZE(t->bits) * MAP_MAX_LOAD)
+        cmap_grow(map, self, t);
+    cmap_leave(self);
+    return true;
+}
+
+/* Remove @key; true if it was present. */
+static inline bool cmap_del(cmap_t *map, struct cmap_thread *self, int key)
+{
+    struct cmap_lock *lock;
+    size_t b;
+
+    cmap_enter(map, self);
+    struct cmap_table *t = cmap_lock_bucket(map, key, &lock, &b);
+
+    struct cmap_node *p =
+        atomic_load_explicit(&t->heads[b], memory_order_relaxed);
+    for (; p; p = atomic_load_explicit(&p->next, memory_order_relaxed)) {
+        if (p->key == key)
+            break;
+    }
+    if (p) {
+        /* Readers already on @p still find a valid next pointer. */
+        struct cmap_node *next =
+            atomic_load_explicit(&p->next, memory_order_relaxed);
+        atomic_store_explicit(p->pprev, next, memory_order_release);
+        if (next)
+            next->pprev = p->pprev;
+        atomic_fetch_sub_explicit(&map->count, 1, memory_order_relaxed);
+    }
+    cmap_unlock(lock);
+    cmap_leave(self);
+
+    if (p)
+        cmap_retire(map, self, p);
+    return p != NULL;
+}
+
+/* Tear down the map; no thread may still be inside it. */
+static inline void cmap_deinit(cmap_t *map)
+{
+    if (!map)
+        return;
+
+    for (int i = 0; i < CMAP_MAX_THREADS; i++) {
+        struct cmap_thread *th = &map->threads[i];
+        cmap_reclaim(th, (unsigned long) -1);
+    }
+    for (struct cmap_node *p = map->orphans, *next; p; p = next) {
+        next = p->retired_next;
+        free(p);
+    }
+    for (struct cmap_table *t = map->orphan_tables, *next; t; t = next) {
+        next = t->retired_next;
+        cmap_table_free(t);
+    }
+    cmap_table_free(atomic_load(&map->table));
+    pthread_mutex_destroy(&map->lock);
+    free(map);
+}
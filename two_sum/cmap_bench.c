@@ -0,0 +1,132 @@
+/* Throughput of cmap_t under mixed read/write loads
+ *
+ * Build: gcc -O2 -pthread -o cmap_bench cmap_bench.c
+ * Usage: ./cmap_bench [keys] [max_threads] [ops_per_thread]
+ *
+ * The map is preloaded with @keys of a key space twice that size. Every
+ * thread then draws random keys from the whole space: reads are cmap_get(),
+ * writes are an even mix of cmap_add() and cmap_del(), so the size stays
+ * roughly constant and retired nodes keep flowing through reclamation.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cmap.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct worker {
+    cmap_t *map;
+    size_t keys, ops;
+    int read_pct;
+    uint64_t seed;
+    long hits;
+    pthread_t thread;
+};
+
+static inline uint64_t xorshift64(uint64_t *s)
+{
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+static inline int key_of(size_t i)
+{
+    return (int) (i * 2654435761u);
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+    struct cmap_thread *self = cmap_thread_register(w->map);
+    assert(self);
+
+    for (size_t i = 0; i < w->ops; i++) {
+        uint64_t r = xorshift64(&w->seed);
+        int key = key_of((r >> 8) % (2 * w->keys));
+        if ((int) (r & 0x7f) * 100 < w->read_pct * 128) {
+            long v;
+            w->hits += cmap_get(w->map, self, key, &v);
+        } else if (r & 0x80) {
+            cmap_add(w->map, self, key, (long) i);
+        } else {
+            cmap_del(w->map, self, key);
+        }
+    }
+
+    cmap_thread_unregister(w->map, self);
+    return NULL;
+}
+
+static double run(size_t keys, size_t ops, int threads, int read_pct)
+{
+    /* Size for the whole key space so that no run pays for a grow. */
+    int bits = 10;
+    while (bits < MAP_MAX_BITS && (size_t) MAP_HASH_SIZE(bits) < 2 * keys)
+        bits++;
+    cmap_t *map = cmap_init(bits);
+    assert(map);
+    struct cmap_thread *self = cmap_thread_register(map);
+    for (size_t i = 0; i < keys; i++)
+        cmap_add(map, self, key_of(2 * i), (long) i);
+    cmap_thread_unregister(map, self);
+
+    struct worker *w = calloc(threads, sizeof(struct worker));
+    assert(w);
+    double t0 = now();
+    for (int t = 0; t < threads; t++) {
+        w[t] = (struct worker){.map = map,
+                               .keys = keys,
+                               .ops = ops,
+                               .read_pct = read_pct,
+                               .seed = 0x9E3779B97F4A7C15ULL * (t + 1)};
+        pthread_create(&w[t].thread, NULL, worker_main, &w[t]);
+    }
+    for (int t = 0; t < threads; t++)
+        pthread_join(w[t].thread, NULL);
+    double elapsed = now() - t0;
+
+    free(w);
+    cmap_deinit(map);
+    return (double) ops * threads / elapsed * 1e-6;
+}
+
+int main(int argc, char **argv)
+{
+    size_t keys = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 20;
+    int max_threads = argc > 2 ? atoi(argv[2])
+                               : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    size_t ops = argc > 3 ? strtoul(argv[3], NULL, 10) : 2000000;
+    if (max_threads < 1)
+        max_threads = 1;
+
+    static const int read_pcts[] = {100, 95, 80, 50};
+    printf("keys = %zu, %zu ops per thread, Mops/s (speedup over 1 thread)\n",
+           keys, ops);
+    for (size_t k = 0; k < sizeof(read_pcts) / sizeof(read_pcts[0]); k++) {
+        double base = 0;
+        printf("reads %3d%%:", read_pcts[k]);
+        for (int t = 1; t <= max_threads; t *= 2) {
+            double mops = run(keys, ops, t, read_pcts[k]);
+            if (t == 1)
+                base = mops;
+            printf("  T=%d %.1f (%.2fx)", t, mops, mops / base);
+        }
+        printf("\n");
+    }
+    return 0;
+}
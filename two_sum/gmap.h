@@ -0,0 +1,265 @@
+/* Type-generic open-addressing hash map, instantiated per key/value type */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * GMAP_DEFINE() - instantiate a map from @K to @V named @name
+ * @name: prefix of the generated type name##_t and functions name##_*()
+ * @K:    key type, passed and stored by value
+ * @V:    value type, stored by value in the slot array
+ * @HASH: uint64_t HASH(K) - must mix well into the high bits
+ * @EQ:   bool EQ(K, K)
+ *
+ *   GMAP_DEFINE(u64map, uint64_t, uint64_t, gmap_hash_u64, GMAP_EQ)
+ *   u64map_t *m = u64map_init(10);
+ *   u64map_add(m, 42, 7);
+ *   uint64_t *v = u64map_get(m, 42);   // NULL when absent
+ *   u64map_deinit(m);
+ *
+ * Unlike map_t there is no boxing: each slot holds the key and value
+ * themselves, so a hit costs the tag probe plus one slot access, and the
+ * compiler sees the concrete hash and equality functions and inlines them.
+ * Slots are probed linearly from the top bits of the hash. A parallel array
+ * of 32-bit tags (the upper hash half, never 0) marks occupancy and filters
+ * out almost every mismatch before @EQ runs, which matters for string keys.
+ * The slot index comes from the same upper half, so the table can double at
+ * 3/4 occupancy without calling @HASH again. Pointers returned by
+ * name##_get() stay valid until the next name##_add(). Keys and values are
+ * not freed by name##_deinit().
+ */
+
+#define GMAP_EQ(a, b) ((a) == (b))
+
+/* Slot indices must fit in the 31 tag bits above the occupancy bit. */
+#define GMAP_MAX_BITS 31
+
+/* Fibonacci hashing: the high product bits depend on every key bit. */
+static inline uint64_t gmap_hash_u64(uint64_t key)
+{
+    uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+/* wyhash (final version 4) by Wang Yi, released into the public domain. */
+static const uint64_t gmap_wyp[4] = {0x2d358dccaa6c78a5ULL,
+                                     0x8bb84b93962eacc9ULL,
+                                     0x4b33a62ed433d4a3ULL,
+                                     0x4d5a2da51de1aa47ULL};
+
+static inline void gmap_wymum(uint64_t *a, uint64_t *b)
+{
+    __uint128_t r = (__uint128_t) *a * *b;
+    *a = (uint64_t) r;
+    *b = (uint64_t) (r >> 64);
+}
+
+static inline uint64_t gmap_wymix(uint64_t a, uint64_t b)
+{
+    gmap_wymum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t gmap_wyr8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t gmap_wyr4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t gmap_wyr3(const uint8_t *p, size_t k)
+{
+    return ((uint64_t) p[0] << 16) | ((uint64_t) p[k >> 1] << 8) | p[k - 1];
+}
+
+static inline uint64_t gmap_wyhash(const void *key, size_t len, uint64_t seed)
+{
+    const uint64_t *s = gmap_wyp;
+    const uint8_t *p = key;
+    uint64_t a, b;
+
+    seed ^= gmap_wymix(seed ^ s[0], s[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (gmap_wyr4(p) << 32) | gmap_wyr4(p + ((len >> 3) << 2));
+            b = (gmap_wyr4(p + len - 4) << 32) |
+                gmap_wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = gmap_wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = gmap_wymix(gmap_wyr8(p) ^ s[1], gmap_wyr8(p + 8) ^ seed);
+                see1 = gmap_wymix(gmap_wyr8(p + 16) ^ s[2],
+                                  gmap_wyr8(p + 24) ^ see1);
+                see2 = gmap_wymix(gmap_wyr8(p + 32) ^ s[3],
+                                  gmap_wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = gmap_wymix(gmap_wyr8(p) ^ s[1], gmap_wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = gmap_wyr8(p + i - 16);
+        b = gmap_wyr8(p + i - 8);
+    }
+    a ^= s[1];
+    b ^= seed;
+    gmap_wymum(&a, &b);
+    return gmap_wymix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+/* NUL-terminated string keys; the map stores the pointer, not a copy. */
+static inline uint64_t gmap_hash_str(const char *key)
+{
+    return gmap_wyhash(key, strlen(key), 0);
+}
+
+static inline bool gmap_eq_str(const char *a, const char *b)
+{
+    return a == b || strcmp(a, b) == 0;
+}
+
+/* Hash a key's object representation; the type must have no padding. */
+#define GMAP_HASH_BYTES(key) gmap_wyhash(&(key), sizeof(key), 0)
+
+#define GMAP_DEFINE(name, K, V, HASH, EQ)                                    \
+    typedef struct {                                                         \
+        K key;                                                               \
+        V val;                                                               \
+    } name##_slot;                                                           \
+                                                                             \
+    typedef struct {                                                         \
+        int bits;                                                            \
+        size_t count;                                                        \
+        uint32_t *tags; /* 0 marks an empty slot */                          \
+        name##_slot *slots;                                                  \
+    } name##_t;                                                              \
+                                                                             \
+    static inline uint32_t name##_tag(uint64_t h)                            \
+    {                                                                        \
+        return (uint32_t) (h >> 32) | 1;                                     \
+    }                                                                        \
+                                                                             \
+    static inline bool name##_alloc(name##_t *map, int bits)                 \
+    {                                                                        \
+        size_t n = (size_t) 1 << bits;                                       \
+        uint32_t *tags = calloc(n, sizeof(uint32_t));                        \
+        name##_slot *slots = malloc(sizeof(name##_slot) * n);                \
+        if (!tags || !slots) {                                               \
+            free(tags);                                                      \
+            free(slots);                                                     \
+            return false;                                                    \
+        }                                                                    \
+        map->bits = bits;                                                    \
+        map->tags = tags;                                                    \
+        map->slots = slots;                                                  \
+        return true;                                                         \
+    }                                                                        \
+                                                                             \
+    static inline name##_t *name##_init(int bits)                            \
+    {                                                                        \
+        name##_t *map = malloc(sizeof(name##_t));                            \
+        if (!map)                                                            \
+            return NULL;                                                     \
+        if (bits < 2)                                                        \
+            bits = 2;                                                        \
+        map->count = 0;                                                      \
+        if (!name##_alloc(map, bits)) {                                      \
+            free(map);                                                       \
+            return NULL;                                                     \
+        }                                                                    \
+        return map;                                                          \
+    }                                                                        \
+                                                                             \
+    static inline void name##_deinit(name##_t *map)                          \
+    {                                                                        \
+        if (!map)                                                            \
+            return;                                                          \
+        free(map->tags);                                                     \
+        free(map->slots);                                                    \
+        free(map);                                                           \
+    }                                                                        \
+                                                                             \
+    /* Slot holding @key, or the empty slot where it would go. */            \
+    static inline size_t name##_probe(const name##_t *map, K key, uint64_t h) \
+    {                                                                        \
+        size_t mask = ((size_t) 1 << map->bits) - 1;                         \
+        size_t i = (size_t) (h >> (64 - map->bits));                         \
+        uint32_t tag = name##_tag(h);                                        \
+        for (;; i = (i + 1) & mask) {                                        \
+            uint32_t t = map->tags[i];                                       \
+            if (!t || (t == tag && EQ(map->slots[i].key, key)))              \
+                return i;                                                    \
+        }                                                                    \
+    }                                                                        \
+                                                                             \
+    static inline V *name##_get(name##_t *map, K key)                        \
+    {                                                                        \
+        size_t i = name##_probe(map, key, HASH(key));                        \
+        return map->tags[i] ? &map->slots[i].val : NULL;                     \
+    }                                                                        \
+                                                                             \
+    static inline bool name##_grow(name##_t *map)                            \
+    {                                                                        \
+        name##_t old = *map;                                                 \
+        if (old.bits >= GMAP_MAX_BITS)                                       \
+            return false;                                                    \
+        if (!name##_alloc(map, old.bits + 1)) {                              \
+            *map = old;                                                      \
+            return false;                                                    \
+        }                                                                    \
+        for (size_t j = 0; j < (size_t) 1 << old.bits; j++) {                \
+            if (!old.tags[j])                                                \
+                continue;                                                    \
+            uint64_t h = (uint64_t) old.tags[j] << 32;                       \
+            size_t i = name##_probe(map, old.slots[j].key, h);               \
+            map->tags[i] = old.tags[j];                                      \
+            map->slots[i] = old.slots[j];                                    \
+        }                                                                    \
+        free(old.tags);                                                      \
+        free(old.slots);                                                     \
+        return true;                                                         \
+    }                                                                        \
+                                                                             \
+    /* Insert @key -> @val unless @key is present; true if inserted. */      \
+    static inline bool name##_add(name##_t *map, K key, V val)               \
+    {                                                                        \
+        uint64_t h = HASH(key);                                              \
+        size_t i = name##_probe(map, key, h);                                \
+        if (map->tags[i])                                                    \
+            return false;                                                    \
+        size_t cap = (size_t) 1 << map->bits;                                \
+        if (map->count + 1 > cap - cap / 4) {                                \
+            if (!name##_grow(map))                                           \
+                return false;                                                \
+            i = name##_probe(map, key, h);                                   \
+        }                                                                    \
+        map->tags[i] = name##_tag(h);                                        \
+        map->slots[i].key = key;                                             \
+        map->slots[i].val = val;                                             \
+        map->count++;                                                        \
+        return true;                                                         \
+    }
@@ -0,0 +1,188 @@
+/* Instantiated gmap maps against the boxed void * map_t
+ *
+ * Build: gcc -O2 -o gmap_bench gmap_bench.c
+ * Usage: ./gmap_bench [keys]
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "gmap.h"
+#include "map.h"
+
+struct point {
+    int32_t x, y;
+};
+
+static inline uint64_t hash_int(int key)
+{
+    return gmap_hash_u64((uint32_t) key);
+}
+
+static inline uint64_t hash_point(struct point p)
+{
+    return GMAP_HASH_BYTES(p);
+}
+
+static inline bool eq_point(struct point a, struct point b)
+{
+    return a.x == b.x && a.y == b.y;
+}
+
+GMAP_DEFINE(imap, int, int, hash_int, GMAP_EQ)
+GMAP_DEFINE(u64map, uint64_t, uint64_t, gmap_hash_u64, GMAP_EQ)
+GMAP_DEFINE(smap, const char *, uint32_t, gmap_hash_str, gmap_eq_str)
+GMAP_DEFINE(pmap, struct point, double, hash_point, eq_point)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t *order; /* random lookup order shared by all runs */
+static size_t n;
+
+static void report(const char *name, double t_add, double t_get)
+{
+    printf("%-22s %10.1f %10.1f\n", name, t_add * 1e9 / n, t_get * 1e9 / n);
+}
+
+static inline int key_of(size_t i)
+{
+    return (int) (i * 2654435761u);
+}
+
+static void bench_int(void)
+{
+    long sum = 0;
+
+    /* map_t with a malloc()ed int per entry, as twoSum() used to box. */
+    map_t *map = map_init(10);
+    double t0 = now();
+    for (size_t i = 0; i < n; i++) {
+        int *p = malloc(sizeof(int));
+        *p = (int) i;
+        map_add(map, key_of(i), p);
+    }
+    double t1 = now();
+    for (size_t i = 0; i < n; i++)
+        sum += *(int *) map_get(map, key_of(order[i]));
+    report("map_t boxed int", t1 - t0, now() - t1);
+    map_deinit(map);
+
+    map = map_init(10);
+    t0 = now();
+    for (size_t i = 0; i < n; i++) {
+        int v = (int) i;
+        map_add_value(map, key_of(i), &v, sizeof(v));
+    }
+    t1 = now();
+    for (size_t i = 0; i < n; i++)
+        sum += *(int *) map_get(map, key_of(order[i]));
+    report("map_t inline int", t1 - t0, now() - t1);
+    map_deinit(map);
+
+    imap_t *imap = imap_init(10);
+    t0 = now();
+    for (size_t i = 0; i < n; i++)
+        imap_add(imap, key_of(i), (int) i);
+    t1 = now();
+    for (size_t i = 0; i < n; i++)
+        sum += *imap_get(imap, key_of(order[i]));
+    report("gmap int -> int", t1 - t0, now() - t1);
+    imap_deinit(imap);
+
+    assert(sum == (long) (n * (n - 1) / 2) * 3);
+}
+
+static void bench_u64(void)
+{
+    uint64_t sum = 0;
+    u64map_t *map = u64map_init(10);
+    double t0 = now();
+    for (size_t i = 0; i < n; i++)
+        u64map_add(map, (uint64_t) i << 20, i);
+    double t1 = now();
+    for (size_t i = 0; i < n; i++)
+        sum += *u64map_get(map, (uint64_t) order[i] << 20);
+    report("gmap u64 -> u64", t1 - t0, now() - t1);
+    assert(sum == n * (n - 1) / 2);
+    u64map_deinit(map);
+}
+
+static void bench_str(void)
+{
+    char *buf = malloc(n * 32);
+    const char **keys = malloc(sizeof(char *) * n);
+    assert(buf && keys);
+    for (size_t i = 0; i < n; i++) {
+        snprintf(buf + i * 32, 32, "user:%zu:session", i);
+        keys[i] = buf + i * 32;
+    }
+
+    uint64_t sum = 0;
+    smap_t *map = smap_init(10);
+    double t0 = now();
+    for (size_t i = 0; i < n; i++)
+        smap_add(map, keys[i], (uint32_t) i);
+    double t1 = now();
+    char probe[32];
+    for (size_t i = 0; i < n; i++) {
+        /* A fresh copy, so equality really compares the bytes. */
+        memcpy(probe, keys[order[i]], 32);
+        sum += *smap_get(map, probe);
+    }
+    report("gmap string -> u32", t1 - t0, now() - t1);
+    assert(sum == n * (n - 1) / 2);
+    smap_deinit(map);
+    free(keys);
+    free(buf);
+}
+
+static void bench_point(void)
+{
+    double sum = 0;
+    pmap_t *map = pmap_init(10);
+    double t0 = now();
+    for (size_t i = 0; i < n; i++) {
+        struct point p = {(int32_t) (i % 1000), (int32_t) (i / 1000)};
+        pmap_add(map, p, (double) i);
+    }
+    double t1 = now();
+    for (size_t i = 0; i < n; i++) {
+        struct point p = {(int32_t) (order[i] % 1000),
+                          (int32_t) (order[i] / 1000)};
+        sum += *pmap_get(map, p);
+    }
+    report("gmap point -> double", t1 - t0, now() - t1);
+    assert(sum == (double) n * (n - 1) / 2);
+    pmap_deinit(map);
+}
+
+int main(int argc, char **argv)
+{
+    n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 20;
+    order = malloc(sizeof(size_t) * n);
+    assert(order && n > 1);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = ((size_t) rand() << 16 ^ rand()) % (i + 1);
+        size_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    printf("n = %zu keys\n%-22s %10s %10s\n", n, "ns/op", "insert", "hit");
+    bench_int();
+    bench_u64();
+    bench_str();
+    bench_point();
+    free(order);
+    return 0;
+}
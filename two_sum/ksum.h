@@ -0,0 +1,305 @@
+/* Distinct k-sum tuples (3Sum, 4Sum, ...) over a twosum_index_t */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tpool.h"
+#include "twosum.h"
+
+/**
+ * Usage:
+ *
+ *   twosum_index_t *ix = twosum_build(nums, n, TWOSUM_SORTED);
+ *   struct ksum_result r;
+ *   ksum(ix, 3, 0, true, &r, pool);        // pool may be NULL
+ *   for (size_t t = 0; t < r.count; t++)
+ *       ... r.tuples[t * 3 + 0..2] ...
+ *   ksum_result_free(&r);
+ *
+ * A tuple is k values taken from k distinct positions of nums whose sum is
+ * the target. Tuples are reported once per distinct multiset of values, each
+ * in ascending order, and the list is in lexicographic order.
+ *
+ * Every call works on the index's sorted copy of nums, so one index serves
+ * any number of targets and k without rebuilding anything. The search fixes
+ * the smallest value, skipping repeats, and recurses on the rest of the
+ * array until two values remain, which a two-pointer scan finds with
+ * twosum_sorted_one()'s skipping helpers. Prefix sums prune each level: if
+ * the k smallest values left already overshoot the target, no later choice
+ * can fit either; if the value plus the k - 1 largest values falls short, the
+ * next value is tried. That is O(n^(k-1)) steps and no allocation, where
+ * calling twoSum() for every (k-2)-prefix builds O(n^(k-2)) maps of up to n
+ * entries each and still has to deduplicate what they find.
+ *
+ * With a pool, the choices of the smallest value are split across workers;
+ * later choices have shorter suffixes, so tasks vary in size and stealing
+ * evens them out.
+ */
+
+#ifndef KSUM_MAX_K
+#define KSUM_MAX_K 8
+#endif
+
+/* Two-pointer steps per task before the outer loop stops splitting. */
+#ifndef KSUM_GRAIN_OPS
+#define KSUM_GRAIN_OPS (1L << 20)
+#endif
+
+struct ksum_result {
+    size_t count; /* distinct tuples */
+    int *tuples;  /* count * k values when listing, else NULL */
+};
+
+/* Tuples found by one task, kept in the order they were found. */
+struct ksum_list {
+    int *v;
+    size_t count, cap;
+};
+
+struct ksum_ctx {
+    const int *v; /* sorted values */
+    long *pre;    /* pre[i] = v[0] + ... + v[i - 1] */
+    int n, k;
+    bool list;
+    struct ksum_list *lists; /* per first index, when listing */
+    size_t grain;
+    atomic_size_t count;
+    atomic_bool failed;
+};
+
+static inline bool ksum_push(struct ksum_list *l, const int *tuple, int k)
+{
+    if (l->count == l->cap) {
+        size_t cap = l->cap ? l->cap * 2 : 16;
+        int *p = realloc(l->v, sizeof(int) * k * cap);
+        if (!p)
+            return false;
+        l->v = p;
+        l->cap = cap;
+    }
+    memcpy(l->v + l->count * k, tuple, sizeof(int) * k);
+    l->count++;
+    return true;
+}
+
+/* Distinct pairs in v[lo..hi] adding up to @target, after @tuple[0..@d). */
+static inline size_t ksum_pairs(struct ksum_ctx *ctx,
+                                int lo,
+                                int hi,
+                                long target,
+                                int *tuple,
+                                int d,
+                                struct ksum_list *out)
+{
+    const int *v = ctx->v;
+    size_t found = 0;
+
+    while (lo < hi) {
+        long sum = (long) v[lo] + v[hi];
+        if (sum < target) {
+            lo = twosum_skip_below(v, lo, hi, target - v[hi]);
+            continue;
+        }
+        if (sum > target) {
+            hi = twosum_skip_above(v, lo, hi, target - v[lo]);
+            continue;
+        }
+        found++;
+        if (ctx->list) {
+            tuple[d] = v[lo];
+            tuple[d + 1] = v[hi];
+            if (!ksum_push(out, tuple, ctx->k))
+                atomic_store_explicit(&ctx->failed, true,
+                                      memory_order_relaxed);
+        }
+        int x = v[lo], y = v[hi];
+        while (lo < hi && v[lo] == x)
+            lo++;
+        while (hi > lo && v[hi] == y)
+            hi--;
+    }
+    return found;
+}
+
+/* Try v[i] as the smallest of @k values summing to @target. */
+static size_t ksum_from(struct ksum_ctx *ctx,
+                        int i,
+                        int k,
+                        long target,
+                        int *tuple,
+                        int d,
+                        struct ksum_list *out);
+
+/* Distinct @k-tuples in v[start..n) adding up to @target. */
+static inline size_t ksum_rec(struct ksum_ctx *ctx,
+                              int start,
+                              int k,
+                              long target,
+                              int *tuple,
+                              int d,
+                              struct ksum_list *out)
+{
+    if (k == 2)
+        return ksum_pairs(ctx, start, ctx->n - 1, target, tuple, d, out);
+
+    size_t found = 0;
+    for (int i = start; i <= ctx->n - k; i++) {
+        if (i > start && ctx->v[i] == ctx->v[i - 1])
+            continue;
+        if (ctx->pre[i + k] - ctx->pre[i] > target)
+            break;
+        found += ksum_from(ctx, i, k, target, tuple, d, out);
+    }
+    return found;
+}
+
+static size_t ksum_from(struct ksum_ctx *ctx,
+                        int i,
+                        int k,
+                        long target,
+                        int *tuple,
+                        int d,
+                        struct ksum_list *out)
+{
+    int n = ctx->n;
+    if (ctx->v[i] + ctx->pre[n] - ctx->pre[n - k + 1] < target)
+        return 0;
+    tuple[d] = ctx->v[i];
+    return ksum_rec(ctx, i + 1, k - 1, target - ctx->v[i], tuple, d + 1, out);
+}
+
+struct ksum_job {
+    struct ksum_ctx *ctx;
+    int lo, hi; /* choices of the smallest value */
+    long target;
+};
+
+static void ksum_job_run(void *arg)
+{
+    struct ksum_job *job = arg;
+    struct ksum_ctx *ctx = job->ctx;
+
+    if ((size_t) (job->hi - job->lo) > ctx->grain) {
+        int mid = job->lo + (job->hi - job->lo) / 2;
+        struct ksum_job left = {ctx, job->lo, mid, job->target};
+        struct ksum_job right = {ctx, mid, job->hi, job->target};
+        task_t t;
+        tpool_spawn(&t, ksum_job_run, &left);
+        ksum_job_run(&right);
+        tpool_sync(&t);
+        return;
+    }
+
+    int tuple[KSUM_MAX_K];
+    struct ksum_list *out = ctx->list ? &ctx->lists[job->lo] : NULL;
+    size_t found = 0;
+    for (int i = job->lo; i < job->hi; i++) {
+        if (i > 0 && ctx->v[i] == ctx->v[i - 1])
+            continue;
+        if (ctx->pre[i + ctx->k] - ctx->pre[i] > job->target)
+            break;
+        found += ksum_from(ctx, i, ctx->k, job->target, tuple, 0, out);
+    }
+    atomic_fetch_add_explicit(&ctx->count, found, memory_order_relaxed);
+}
+
+/* Gather the per-task lists, which are already in order, into @res. */
+static inline bool ksum_collect(struct ksum_ctx *ctx, struct ksum_result *res)
+{
+    size_t total = atomic_load(&ctx->count);
+    res->tuples = malloc(sizeof(int) * ctx->k * (total ? total : 1));
+    if (!res->tuples)
+        return false;
+
+    size_t at = 0;
+    for (int i = 0; i < ctx->n; i++) {
+        struct ksum_list *l = &ctx->lists[i];
+        if (!l->count)
+            continue;
+        memcpy(res->tuples + at * ctx->k, l->v,
+               sizeof(int) * ctx->k * l->count);
+        at += l->count;
+    }
+    return at == total;
+}
+
+static inline void ksum_result_free(struct ksum_result *res)
+{
+    free(res->tuples);
+    res->tuples = NULL;
+    res->count = 0;
+}
+
+/**
+ * ksum() - find the distinct @k-tuples of @ix's values adding up to @target
+ * @k:    2 to KSUM_MAX_K
+ * @list: also return the tuples themselves, not just their number
+ * @res:  receives the result; release with ksum_result_free()
+ * @pool: worker pool to split the outermost choice across, or NULL
+ *
+ * Returns false for an unsupported @k or when out of memory.
+ */
+static inline bool ksum(const twosum_index_t *ix,
+                        int k,
+                        long target,
+                        bool list,
+                        struct ksum_result *res,
+                        struct tpool *pool)
+{
+    res->count = 0;
+    res->tuples = NULL;
+    if (k < 2 || k > KSUM_MAX_K)
+        return false;
+    if (ix->n < k)
+        return true;
+
+    struct ksum_ctx ctx = {.v = ix->sorted, .n = ix->n, .k = k, .list = list};
+    ctx.pre = malloc(sizeof(long) * (ix->n + 1));
+    ctx.lists = list ? calloc(ix->n, sizeof(struct ksum_list)) : NULL;
+    if (!ctx.pre || (list && !ctx.lists)) {
+        free(ctx.pre);
+        free(ctx.lists);
+        return false;
+    }
+    ctx.pre[0] = 0;
+    for (int i = 0; i < ix->n; i++)
+        ctx.pre[i + 1] = ctx.pre[i] + ix->sorted[i];
+    atomic_init(&ctx.count, 0);
+    atomic_init(&ctx.failed, false);
+
+    /* Each choice of the smallest value costs about n^(k-2) steps. */
+    double per = 1;
+    for (int j = 2; j < k; j++)
+        per *= ix->n;
+    ctx.grain = per >= KSUM_GRAIN_OPS ? 1 : (size_t) (KSUM_GRAIN_OPS / per);
+
+    struct ksum_job root = {&ctx, 0, ix->n - k + 1, target};
+    if (k == 2) {
+        int tuple[2];
+        struct ksum_list *out = list ? &ctx.lists[0] : NULL;
+        atomic_init(&ctx.count,
+                    ksum_pairs(&ctx, 0, ix->n - 1, target, tuple, 0, out));
+    } else if (pool) {
+        tpool_run(pool, ksum_job_run, &root);
+    } else {
+        ksum_job_run(&root);
+    }
+
+    bool ok = !atomic_load(&ctx.failed);
+    res->count = atomic_load(&ctx.count);
+    if (list) {
+        if (ok)
+            ok = ksum_collect(&ctx, res);
+        for (int i = 0; i < ix->n; i++)
+            free(ctx.lists[i].v);
+        free(ctx.lists);
+        if (!ok)
+            ksum_result_free(res);
+    }
+    free(ctx.pre);
+    return ok;
+}
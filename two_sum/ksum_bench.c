@@ -0,0 +1,185 @@
+/* k-sum over one sorted index against a map per fixed prefix
+ *
+ * Build: gcc -O2 -mavx2 -pthread -o ksum_bench ksum_bench.c
+ * Usage: ./ksum_bench [max_n] [threads]
+ *
+ * ksum() is first checked against brute force over every index tuple on
+ * small arrays full of duplicates. The timings then count 3Sum and 4Sum
+ * tuples adding up to 0 for values drawn from [-n, n], the classic setting,
+ * next to the twoSum()-per-prefix approach of building a fresh map_t for
+ * every distinct first value (3Sum only, and only while it stays quick).
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ksum.h"
+#include "map.h"
+#include "twosum.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int k_cmp; /* tuple width for cmp_tuple() */
+
+static int cmp_tuple(const void *lhs, const void *rhs)
+{
+    const int *a = lhs, *b = rhs;
+    for (int i = 0; i < k_cmp; i++)
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
+
+static int cmp_int(const void *lhs, const void *rhs)
+{
+    int a = *(const int *) lhs, b = *(const int *) rhs;
+    return a < b ? -1 : a > b;
+}
+
+/* Every index tuple, sorted and deduplicated; returns the tuple count. */
+static size_t brute(const int *nums, int n, int k, long target, int *out)
+{
+    int idx[KSUM_MAX_K];
+    size_t count = 0;
+    for (int i = 0; i < k; i++)
+        idx[i] = i;
+    while (n >= k) {
+        long sum = 0;
+        for (int i = 0; i < k; i++)
+            sum += nums[idx[i]];
+        if (sum == target) {
+            for (int i = 0; i < k; i++)
+                out[count * k + i] = nums[idx[i]];
+            qsort(out + count * k, k, sizeof(int), cmp_int);
+            count++;
+        }
+        int i = k - 1;
+        while (i >= 0 && idx[i] == n - k + i)
+            i--;
+        if (i < 0)
+            break;
+        idx[i]++;
+        for (int j = i + 1; j < k; j++)
+            idx[j] = idx[j - 1] + 1;
+    }
+
+    k_cmp = k;
+    qsort(out, count, sizeof(int) * k, cmp_tuple);
+    size_t uniq = 0;
+    for (size_t t = 0; t < count; t++)
+        if (!uniq || cmp_tuple(out + (uniq - 1) * k, out + t * k))
+            memmove(out + uniq++ * k, out + t * k, sizeof(int) * k);
+    return uniq;
+}
+
+static void run_checks(struct tpool *pool)
+{
+    static int expect[40 * 40 * 40 * 40 / 24 * 4 + 64];
+    int nums[40];
+    for (int round = 0; round < 200; round++) {
+        int n = rand() % 40, k = 2 + round % 3;
+        int range = round & 8 ? 7 : 40;
+        for (int i = 0; i < n; i++)
+            nums[i] = rand() % (2 * range + 1) - range;
+        long target = rand() % (2 * range + 1) - range;
+
+        size_t c = brute(nums, n, k, target, expect);
+        twosum_index_t *ix = twosum_build(nums, n, TWOSUM_SORTED);
+        struct ksum_result r, counted;
+        assert(ix && ksum(ix, k, target, true, &r, round & 1 ? pool : NULL));
+        assert(ksum(ix, k, target, false, &counted, pool));
+        assert(r.count == c && counted.count == c && !counted.tuples);
+        assert(!c || !memcmp(r.tuples, expect, sizeof(int) * k * c));
+        ksum_result_free(&r);
+        twosum_free(ix);
+    }
+    printf("checks passed\n");
+}
+
+/* 3Sum the twoSum() way: a fresh map over the suffix of each first value. */
+static size_t threesum_maps(const int *v, int n, long target)
+{
+    size_t found = 0;
+    for (int i = 0; i < n - 2; i++) {
+        if (i && v[i] == v[i - 1])
+            continue;
+        map_t *seen = map_init(10);
+        long last = LONG_MIN;
+        for (int j = i + 1; j < n; j++) {
+            long want = target - v[i] - v[j];
+            if (want >= INT_MIN && want <= INT_MAX && v[j] != last &&
+                map_get(seen, (int) want)) {
+                found++;
+                last = v[j];
+            }
+            if (!map_get(seen, v[j]))
+                map_add_value(seen, v[j], &j, sizeof(j));
+        }
+        map_deinit(seen);
+    }
+    return found;
+}
+
+int main(int argc, char **argv)
+{
+    int max_n = argc > 1 ? atoi(argv[1]) : 100000;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    struct tpool *pool = tpool_create(threads);
+    int *nums = malloc(sizeof(int) * max_n);
+    assert(pool && nums);
+
+    srand(1);
+    run_checks(pool);
+
+    printf("%d threads, values in [-n, n], target 0\n", pool->nthreads);
+    printf("%8s %3s %10s %12s %12s %12s\n", "n", "k", "tuples", "ksum ms",
+           "list ms", "maps ms");
+    for (int n = 1000; n <= max_n; n *= 10) {
+        for (int i = 0; i < n; i++)
+            nums[i] = rand() % (2 * n + 1) - n;
+        twosum_index_t *ix = twosum_build(nums, n, TWOSUM_SORTED);
+        assert(ix);
+
+        for (int k = 3; k <= 4; k++) {
+            if (k == 4 && n > 1000)
+                break;
+            struct ksum_result r;
+            double t0 = now();
+            assert(ksum(ix, k, 0, false, &r, pool));
+            double t_count = now() - t0;
+            size_t count = r.count;
+
+            /* Listing 3Sum at n = 10^5 would take gigabytes. */
+            char list[24] = "-";
+            if (count <= 1 << 25) {
+                t0 = now();
+                assert(ksum(ix, k, 0, true, &r, pool));
+                snprintf(list, sizeof(list), "%.1f", (now() - t0) * 1e3);
+                assert(r.count == count);
+                ksum_result_free(&r);
+            }
+
+            char maps[24] = "-";
+            if (k == 3 && n <= 10000) {
+                t0 = now();
+                assert(threesum_maps(ix->sorted, n, 0) == count);
+                snprintf(maps, sizeof(maps), "%.1f", (now() - t0) * 1e3);
+            }
+            printf("%8d %3d %10zu %12.1f %12s %12s\n", n, k, count,
+                   t_count * 1e3, list, maps);
+        }
+        twosum_free(ix);
+    }
+
+    tpool_print_stats(pool, "ksum");
+    tpool_destroy(pool);
+    free(nums);
+    return 0;
+}
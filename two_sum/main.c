@@ -1,32 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "list.h"
-
-#define AAAA 10
-#define BBBB 10
-#define CCCC first->pprev
-#define DDDD n->pprev
-#define EEEE n->pprev
-#define MAP_HASH_SIZE(number) (1 << (number))
-
-struct hlist_head {
-	struct hlist_node *first;
-};
-
-struct hlist_node {
-	struct hlist_node *next, **pprev;
-};
-
-typedef struct {
-    int bits;
-    struct hlist_head *ht;
-} map_t;
-
-struct hash_key {
-    int key;
-    void *data;
-    struct hlist_node node;
-};
+#include "map.h"
+#include "perf.h"
 
 static int cmp(const void *lhs, const void *rhs) {
     if (*(int *) lhs == *(int *) rhs)
@@ -41,97 +17,7 @@ static int *alloc_wrapper(int a, int b, int *returnSize) {
     return res;
 }
 
-map_t *map_init(int bits)
-{
-    map_t *map = malloc(sizeof(map_t));
-    if (!map)
-        return NULL;
-
-    map->bits = bits;
-    map->ht = malloc(sizeof(struct hlist_head) * MAP_HASH_SIZE(map->bits));
-    if (map->ht) {
-        for (int i = 0; i < MAP_HASH_SIZE(map->bits); i++)
-            (map->ht)[i].first = NULL;
-    } else {
-        free(map);
-        map = NULL;
-    }
-    return map;
-}
-
-#define GOLDEN_RATIO_32 0x61C88647
-static inline unsigned int hash(unsigned int val, unsigned int bits)
-{
-    /* High bits are more random, so use them. */
-    return (val * GOLDEN_RATIO_32) >> (32 - bits);
-}
-
-static struct hash_key *find_key(map_t *map, int key)
-{
-    struct hlist_head *head = &(map->ht)[hash(key, AAAA)];
-    for (struct hlist_node *p = head->first; p; p = p->next) {
-        struct hash_key *kn = container_of(p, struct hash_key, node);
-        if (kn->key == key)
-            return kn;
-    }
-    return NULL;
-}
-
-void *map_get(map_t *map, int key)
-{
-    struct hash_key *kn = find_key(map, key);
-    return kn ? kn->data : NULL;
-}
-
-void map_add(map_t *map, int key, void *data)
-{
-    struct hash_key *kn = find_key(map, key);
-    if (kn)
-        return;
-
-    kn = malloc(sizeof(struct hash_key));
-    kn->key = key, kn->data = data;
-
-    struct hlist_head *h = &map->ht[hash(key, BBBB)];
-    struct hlist_node *n = &kn->node, *first = h->first;
-
-    n->next = first;
-    if (first)
-        CCCC = &n->next;
-    h->first = n;
-    DDDD = &h->first;
-}
-
-
-void map_deinit(map_t *map)
-{
-    if (!map)
-        return;
-
-    for (int i = 0; i < MAP_HASH_SIZE(map->bits); i++) {
-        struct hlist_head *head = &map->ht[i];
-        for (struct hlist_node *p = head->first; p;) {
-            struct hash_key *kn = container_of(p, struct hash_key, node);
-            struct hlist_node *n = p;
-            p = p->next;
-
-            if (!n->pprev) /* unhashed */
-                goto bail;
-
-            struct hlist_node *next = n->next, **pprev = EEEE;
-            *pprev = next;
-            if (next)
-                next->pprev = pprev;
-            n->next = NULL, n->pprev = NULL;
-
-        bail:
-            free(kn->data);
-            free(kn);
-        }
-    }
-    free(map);
-}
-
+PERF_REGION(twosum_region, "twoSum map_get/map_add loop");
 
 int *twoSum(int *nums, int numsSize, int target, int *returnSize)
 {
@@ -141,6 +27,7 @@ int *twoSum(int *nums, int numsSize, int target, int *returnSize)
     if (!ret)
         goto bail;
 
+    PERF_BEGIN(twosum_region);
     for (int i = 0; i < numsSize; i++) {
         int *p = map_get(map, target - nums[i]);
         if (p) { /* found */
@@ -149,10 +36,9 @@ int *twoSum(int *nums, int numsSize, int target, int *returnSize)
             break;
         }
 
-        p = malloc(sizeof(int));
-        *p = i;
-        map_add(map, nums[i], p);
+        map_add_value(map, nums[i], &i, sizeof(i));
     }
+    PERF_END(twosum_region);
 
 bail:
     map_deinit(map);
@@ -168,5 +54,6 @@ int main()
     int *ret = twoSum(nums, 4, target, &returnSize);
     printf("returnSize: %d\n",returnSize);
     printf("%d, %d\n",ret[0],ret[1]);
+    PERF_REPORT(twosum_region);
     return 0;
 }
@@ -0,0 +1,1037 @@
+/* Hash map from int keys to pointers, chained on hlist buckets */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "list.h"
+
+#define MAP_HASH_SIZE(number) (1 << (number))
+
+/* Grow once the average chain is longer than this many entries. */
+#ifndef MAP_MAX_LOAD
+#define MAP_MAX_LOAD 1
+#endif
+
+/* Old buckets migrated per map_add()/map_get() while a rehash is running. */
+#ifndef MAP_REHASH_STEP
+#define MAP_REHASH_STEP 4
+#endif
+
+#define MAP_MAX_BITS 30
+
+/* Bytes per arena chunk for nodes and inline values. */
+#ifndef MAP_CHUNK_SIZE
+#define MAP_CHUNK_SIZE (64 * 1024)
+#endif
+
+/* Deleted nodes up to this many 16-byte units are recycled by size. */
+#define MAP_FREE_CLASSES 16
+
+struct hlist_head {
+    struct hlist_node *first;
+};
+
+struct hlist_node {
+    struct hlist_node *next, **pprev;
+};
+
+/* Lookup outcomes and the chain nodes they compared keys against. */
+struct map_probe_stats {
+    size_t hits, misses;
+    size_t hit_probes, miss_probes;
+};
+
+/**
+ * struct map_bloom - blocked Bloom filter over the keys of a map_t
+ *
+ * Each key picks one 64-byte block, a single cache line, and sets one bit
+ * in each of its eight 64-bit words; the bit positions come from multiplying
+ * the key's hash by eight odd salts. A query therefore costs one line and,
+ * with AVX2, a couple of vector multiplies, shifts and one vptest, and a
+ * key whose bits are not all set is certainly absent. Bits are never
+ * cleared by map_del(), which only makes false positives more likely.
+ */
+struct map_bloom {
+    uint64_t (*blocks)[8];
+    int bits; /* 2^bits blocks */
+    size_t capacity;
+
+    size_t queries;    /* keys looked up through the filter */
+    size_t negatives;  /* rejected without touching the table */
+    size_t false_pos;  /* passed by the filter but not in the map */
+};
+
+struct map_chunk {
+    struct map_chunk *next;
+    size_t size, used;
+    _Alignas(16) char mem[];
+};
+
+/**
+ * map_t - chained hash map with incremental resizing
+ *
+ * When the load factor passes MAP_MAX_LOAD a table twice the size is
+ * allocated and the current one becomes @old_ht. From then on every
+ * map_add() and map_get() moves a few old buckets over, starting at
+ * @rehash_idx, so no single operation pays for a full rehash. Lookups check
+ * both tables until the migration finishes; inserts only go to @ht. A large
+ * old table is returned to the kernel a huge page at a time as migration
+ * passes it, so neither does any single operation pay for freeing it.
+ *
+ * Nodes, and values added with map_add_value(), are bump-allocated from
+ * @chunks and released all at once by map_deinit(), which therefore costs
+ * O(chunks) instead of a walk over every bucket and node. Only data handed
+ * over with map_add() is owned per entry and must still be freed one by one;
+ * @owned counts those so the walk is skipped when there are none.
+ *
+ * map_del() pushes a node onto @free by size, and the next insert of that
+ * size pops it again, so steady insert/delete churn stops growing the arena.
+ * map_clear() keeps the tables and moves every chunk to @spare for reuse.
+ */
+typedef struct {
+    int bits;
+    struct hlist_head *ht;
+    size_t count;
+
+    int old_bits;
+    struct hlist_head *old_ht; /* NULL unless a rehash is in progress */
+    size_t rehash_idx;
+
+    struct map_chunk *chunks, *spare;
+    struct hlist_node *free[MAP_FREE_CLASSES]; /* linked through ->next */
+    size_t owned;
+
+    struct map_bloom *bloom; /* optional, see map_bloom_enable() */
+
+    /* Every @sample_every-th map_get() is counted; 0 disables sampling. */
+    size_t sample_every, sample_tick;
+    struct map_probe_stats sampled;
+} map_t;
+
+struct hash_key {
+    int key;
+    bool owned;     /* @data came from map_add() and is freed with the map */
+    uint16_t units; /* allocation size in 16-byte units, 0 if too large */
+    void *data;
+    struct hlist_node node;
+};
+
+#define GOLDEN_RATIO_32 0x61C88647
+static inline unsigned int hash(unsigned int val, unsigned int bits)
+{
+    /* High bits are more random, so use them. */
+    return (val * GOLDEN_RATIO_32) >> (32 - bits);
+}
+
+static inline void hlist_add_head(struct hlist_node *n, struct hlist_head *h)
+{
+    struct hlist_node *first = h->first;
+
+    n->next = first;
+    if (first)
+        first->pprev = &n->next;
+    h->first = n;
+    n->pprev = &h->first;
+}
+
+static inline void hlist_del(struct hlist_node *n)
+{
+    struct hlist_node *next = n->next, **pprev = n->pprev;
+
+    *pprev = next;
+    if (next)
+        next->pprev = pprev;
+    n->next = NULL, n->pprev = NULL;
+}
+
+static const uint32_t map_bloom_salt[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+};
+
+/* Block index from the high half of a 64-bit hash, bit salt from the low. */
+static inline uint64_t map_bloom_hash(int key)
+{
+    uint64_t h = (uint64_t) (uint32_t) key * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+static inline void map_bloom_insert(struct map_bloom *b, int key)
+{
+    uint64_t h = map_bloom_hash(key);
+    uint64_t *block = b->blocks[h >> (64 - b->bits)];
+    for (int i = 0; i < 8; i++)
+        block[i] |= 1ULL << (((uint32_t) h * map_bloom_salt[i]) >> 26);
+}
+
+/* False when @key is certainly not in the map. */
+static inline bool map_bloom_query(const struct map_bloom *b, int key)
+{
+    uint64_t h = map_bloom_hash(key);
+    const uint64_t *block = b->blocks[h >> (64 - b->bits)];
+#ifdef __AVX2__
+    __m256i salt = _mm256_loadu_si256((const __m256i *) map_bloom_salt);
+    __m256i idx = _mm256_srli_epi32(
+        _mm256_mullo_epi32(_mm256_set1_epi32((int) (uint32_t) h), salt), 26);
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256i lo = _mm256_sllv_epi64(
+        one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(idx)));
+    __m256i hi = _mm256_sllv_epi64(
+        one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(idx, 1)));
+    /* testc: every mask bit is also set in the block. */
+    return _mm256_testc_si256(_mm256_load_si256((const __m256i *) block),
+                              lo) &
+           _mm256_testc_si256(_mm256_load_si256((const __m256i *) block + 1),
+                              hi);
+#else
+    /* Branch-free: a miss in any word clears the low bit. */
+    uint64_t all = 1;
+#pragma GCC unroll 8
+    for (int i = 0; i < 8; i++)
+        all &= block[i] >> (((uint32_t) h * map_bloom_salt[i]) >> 26);
+    return all & 1;
+#endif
+}
+
+static inline void map_bloom_free(struct map_bloom *b)
+{
+    if (b)
+        free(b->blocks);
+    free(b);
+}
+
+/* Tables this large are mapped directly, aligned to and backed by
+ * transparent huge pages: the kernel zeroes them lazily, and faulting 2 MiB
+ * at a time keeps the first-touch cost off all but a handful of inserts.
+ * The alignment also lets a rehash hand the old table back one whole huge
+ * page at a time, see map_release_migrated().
+ */
+#define MAP_HUGE_TABLE (2UL << 20)
+
+static inline struct hlist_head *map_alloc_table(int bits)
+{
+    size_t size = (size_t) MAP_HASH_SIZE(bits) * sizeof(struct hlist_head);
+    if (size < MAP_HUGE_TABLE)
+        return calloc(MAP_HASH_SIZE(bits), sizeof(struct hlist_head));
+
+    /* Over-map by one huge page and trim both ends to align. */
+    char *raw = mmap(NULL, size + MAP_HUGE_TABLE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return NULL;
+    size_t lead = -(uintptr_t) raw & (MAP_HUGE_TABLE - 1);
+    if (lead)
+        munmap(raw, lead);
+    munmap(raw + lead + size, MAP_HUGE_TABLE - lead);
+
+    void *ht = raw + lead;
+#ifdef MADV_HUGEPAGE
+    madvise(ht, size, MADV_HUGEPAGE);
+#endif
+    return ht;
+}
+
+static inline void map_free_table_mem(struct hlist_head *ht, int bits)
+{
+    size_t size = (size_t) MAP_HASH_SIZE(bits) * sizeof(struct hlist_head);
+    if (size < MAP_HUGE_TABLE)
+        free(ht);
+    else
+        munmap(ht, size);
+}
+
+static inline map_t *map_init(int bits)
+{
+    map_t *map = malloc(sizeof(map_t));
+    if (!map)
+        return NULL;
+
+    map->bits = bits;
+    map->count = 0;
+    map->old_bits = 0;
+    map->old_ht = NULL;
+    map->rehash_idx = 0;
+    map->chunks = NULL;
+    map->spare = NULL;
+    memset(map->free, 0, sizeof(map->free));
+    map->owned = 0;
+    map->bloom = NULL;
+    map->sample_every = 0;
+    map->sample_tick = 0;
+    map->sampled = (struct map_probe_stats){0, 0, 0, 0};
+    map->ht = map_alloc_table(map->bits);
+    if (!map->ht) {
+        free(map);
+        map = NULL;
+    }
+    return map;
+}
+
+/* Move old bucket @idx into the new table. */
+static inline void map_migrate_bucket(map_t *map, size_t idx)
+{
+    struct hlist_node *p = map->old_ht[idx].first;
+
+    while (p) {
+        struct hash_key *kn = container_of(p, struct hash_key, node);
+        struct hlist_node *next = p->next;
+        hlist_add_head(p, &map->ht[hash(kn->key, map->bits)]);
+        p = next;
+    }
+    map->old_ht[idx].first = NULL;
+}
+
+/* Old buckets [@from, @to) have been migrated. If that completes any huge
+ * pages of an mmap()ed old table, drop their memory now. The buckets read
+ * back as zero, i.e. empty, which is what they hold anyway, and the final
+ * munmap() is left with only the tail to free instead of the whole table
+ * inside one unlucky map_add() or map_get().
+ */
+static inline void map_release_migrated(map_t *map, size_t from, size_t to)
+{
+    size_t size = (size_t) MAP_HASH_SIZE(map->old_bits) *
+                  sizeof(struct hlist_head);
+    size_t per_page = MAP_HUGE_TABLE / sizeof(struct hlist_head);
+    size_t first = from / per_page, last = to / per_page;
+
+    if (size < MAP_HUGE_TABLE || first == last)
+        return;
+    madvise(map->old_ht + first * per_page, (last - first) * MAP_HUGE_TABLE,
+            MADV_DONTNEED);
+}
+
+/* Migrate up to @steps non-empty old buckets, bounding empty ones too. */
+static inline void map_rehash_step(map_t *map, size_t steps)
+{
+    size_t old_size = MAP_HASH_SIZE(map->old_bits);
+    size_t empty_visits = steps * 10;
+    size_t from = map->rehash_idx;
+
+    while (steps && map->rehash_idx < old_size) {
+        if (!map->old_ht[map->rehash_idx].first) {
+            map->rehash_idx++;
+            if (--empty_visits == 0)
+                break;
+            continue;
+        }
+        map_migrate_bucket(map, map->rehash_idx++);
+        steps--;
+    }
+    map_release_migrated(map, from, map->rehash_idx);
+
+    if (map->rehash_idx == old_size) {
+        map_free_table_mem(map->old_ht, map->old_bits);
+        map->old_ht = NULL;
+    }
+}
+
+static inline void map_rehash_finish(map_t *map)
+{
+    while (map->old_ht)
+        map_rehash_step(map, (size_t) -1 / 16);
+}
+
+/* Start migrating into a table of 2^@bits buckets. */
+static inline bool map_resize(map_t *map, int bits)
+{
+    map_rehash_finish(map);
+
+    struct hlist_head *ht = map_alloc_table(bits);
+    if (!ht)
+        return false;
+
+    map->old_ht = map->ht;
+    map->old_bits = map->bits;
+    map->rehash_idx = 0;
+    map->ht = ht;
+    map->bits = bits;
+    return true;
+}
+
+/**
+ * map_reserve() - make room for @n entries without further resizing
+ *
+ * Unlike load-driven growth this rehashes everything immediately, so call
+ * it up front rather than on a latency-sensitive path.
+ */
+static inline bool map_reserve(map_t *map, size_t n)
+{
+    int bits = map->bits;
+    while (bits < MAP_MAX_BITS &&
+           (size_t) MAP_HASH_SIZE(bits) * MAP_MAX_LOAD < n)
+        bits++;
+    if (bits == map->bits)
+        return true;
+    if (!map_resize(map, bits))
+        return false;
+    map_rehash_finish(map);
+    return true;
+}
+
+/* Bump-allocate @size bytes, a multiple of 16, from the map's arena. */
+static inline void *map_arena_alloc(map_t *map, size_t size)
+{
+    struct map_chunk *c = map->chunks;
+
+    if (size / 16 < MAP_FREE_CLASSES && map->free[size / 16]) {
+        struct hlist_node *n = map->free[size / 16];
+        map->free[size / 16] = n->next;
+        return container_of(n, struct hash_key, node);
+    }
+
+    if (!c || c->used + size > c->size) {
+        if (map->spare && size <= MAP_CHUNK_SIZE) {
+            c = map->spare;
+            map->spare = c->next;
+        } else {
+            size_t chunk = size > MAP_CHUNK_SIZE ? size : MAP_CHUNK_SIZE;
+            c = malloc(sizeof(struct map_chunk) + chunk);
+            if (!c)
+                return NULL;
+            c->size = chunk;
+        }
+        c->used = 0;
+        c->next = map->chunks;
+        map->chunks = c;
+    }
+
+    void *p = c->mem + c->used;
+    c->used += size;
+    return p;
+}
+
+/* Walk @key's chains, adding the number of nodes compared to *@probes. */
+static inline struct hash_key *map_find_chain(map_t *map,
+                                              int key,
+                                              size_t *probes)
+{
+    struct hlist_head *head = &(map->ht)[hash(key, map->bits)];
+    for (struct hlist_node *p = head->first; p; p = p->next) {
+        struct hash_key *kn = container_of(p, struct hash_key, node);
+        (*probes)++;
+        if (kn->key == key)
+            return kn;
+    }
+
+    if (map->old_ht) {
+        size_t idx = hash(key, map->old_bits);
+        if (idx < map->rehash_idx) /* already migrated */
+            return NULL;
+        for (struct hlist_node *p = map->old_ht[idx].first; p; p = p->next) {
+            struct hash_key *kn = container_of(p, struct hash_key, node);
+            (*probes)++;
+            if (kn->key == key)
+                return kn;
+        }
+    }
+    return NULL;
+}
+
+/* Find @key, consulting the Bloom filter first when there is one. */
+static inline struct hash_key *map_find(map_t *map, int key, size_t *probes)
+{
+    if (map->bloom) {
+        map->bloom->queries++;
+        if (!map_bloom_query(map->bloom, key)) {
+            map->bloom->negatives++;
+            return NULL;
+        }
+    }
+
+    struct hash_key *kn = map_find_chain(map, key, probes);
+    if (!kn && map->bloom)
+        map->bloom->false_pos++;
+    return kn;
+}
+
+static inline struct hash_key *find_key(map_t *map, int key)
+{
+    size_t probes = 0; /* dead after inlining */
+    return map_find(map, key, &probes);
+}
+
+static inline void *map_get(map_t *map, int key)
+{
+    if (map->old_ht)
+        map_rehash_step(map, MAP_REHASH_STEP);
+
+    struct hash_key *kn;
+    if (__builtin_expect(map->sample_every != 0, 0) &&
+        ++map->sample_tick >= map->sample_every) {
+        size_t probes = 0;
+        map->sample_tick = 0;
+        kn = map_find(map, key, &probes);
+        if (kn) {
+            map->sampled.hits++;
+            map->sampled.hit_probes += probes;
+        } else {
+            map->sampled.misses++;
+            map->sampled.miss_probes += probes;
+        }
+    } else {
+        kn = find_key(map, key);
+    }
+    return kn ? kn->data : NULL;
+}
+
+/* Lookups kept in flight by map_get_batch(). */
+#ifndef MAP_BATCH_WIDTH
+#define MAP_BATCH_WIDTH 16
+#endif
+
+struct map_lookup {
+    size_t i;                /* index into the batch, or -1 when idle */
+    struct hlist_head *head; /* bucket, while its first pointer is pending */
+    struct hlist_node *p;    /* chain node, once the head has been read */
+};
+
+/**
+ * map_lookup_start() - give @s the next key from @next that needs the table
+ *
+ * Keys the Bloom filter rejects are answered on the spot. Returns the index
+ * after the key taken, with @s left idle once the batch is exhausted.
+ */
+static inline size_t map_lookup_start(map_t *map,
+                                      struct map_lookup *s,
+                                      const int *keys,
+                                      void **out,
+                                      size_t next,
+                                      size_t n,
+                                      size_t *left)
+{
+    for (; next < n; next++) {
+        if (map->bloom) {
+            map->bloom->queries++;
+            if (!map_bloom_query(map->bloom, keys[next])) {
+                map->bloom->negatives++;
+                out[next] = NULL;
+                (*left)--;
+                continue;
+            }
+        }
+        s->i = next;
+        s->head = &map->ht[hash(keys[next], map->bits)];
+        s->p = NULL;
+        __builtin_prefetch(s->head);
+        return next + 1;
+    }
+    s->i = (size_t) -1;
+    return next;
+}
+
+/**
+ * map_get_batch() - look up @n keys at once, storing map_get()'s answers
+ * @map:  the map
+ * @keys: keys to look up
+ * @out:  out[i] receives the data for keys[i], or NULL when absent
+ * @n:    number of keys
+ *
+ * A scalar lookup stalls on the bucket head and then on every chain node.
+ * This keeps MAP_BATCH_WIDTH lookups in flight and advances them round-robin
+ * as small state machines (asynchronous memory access chaining): each step
+ * reads a line prefetched one round earlier, then prefetches the next line
+ * that lookup needs and yields. When a lookup finishes, its slot picks up
+ * the next key, so the misses of independent keys overlap instead of
+ * serialising.
+ *
+ * Maps small enough to stay cache resident take the plain scalar loop. A
+ * running rehash advances by as much as @n calls to map_get() would move it;
+ * keys not found in the new table fall back to the scalar path so that
+ * unmigrated old buckets are still searched.
+ */
+static inline void map_get_batch(map_t *map,
+                                 const int *keys,
+                                 void **out,
+                                 size_t n)
+{
+    struct map_lookup s[MAP_BATCH_WIDTH];
+    size_t next = 0, left = n;
+
+    if (map->old_ht)
+        map_rehash_step(map, MAP_REHASH_STEP * n);
+
+    /* Cache-resident maps gain nothing from the bookkeeping. */
+    if (map->count * (sizeof(struct hash_key) + sizeof(struct hlist_head)) <
+        MAP_HUGE_TABLE) {
+        for (size_t i = 0; i < n; i++) {
+            struct hash_key *kn = find_key(map, keys[i]);
+            out[i] = kn ? kn->data : NULL;
+        }
+        return;
+    }
+
+    for (int k = 0; k < MAP_BATCH_WIDTH; k++)
+        next = map_lookup_start(map, &s[k], keys, out, next, n, &left);
+
+    while (left) {
+        for (int k = 0; k < MAP_BATCH_WIDTH; k++) {
+            struct map_lookup *l = &s[k];
+            if (l->i == (size_t) -1)
+                continue;
+
+            struct hash_key *kn = NULL;
+            if (l->head) {
+                /* Bucket head has arrived; fetch the first node. */
+                l->p = l->head->first;
+                l->head = NULL;
+            } else {
+                kn = container_of(l->p, struct hash_key, node);
+                if (kn->key != keys[l->i]) {
+                    kn = NULL;
+                    l->p = l->p->next;
+                }
+            }
+
+            if (l->p && !kn) {
+                __builtin_prefetch(container_of(l->p, struct hash_key, node));
+                __builtin_prefetch(l->p);
+                continue;
+            }
+
+            /* Hit, or end of chain. */
+            if (!kn && map->old_ht) {
+                size_t probes = 0;
+                kn = map_find_chain(map, keys[l->i], &probes);
+            }
+            if (!kn && map->bloom)
+                map->bloom->false_pos++;
+            out[l->i] = kn ? kn->data : NULL;
+            left--;
+            next = map_lookup_start(map, l, keys, out, next, n, &left);
+        }
+    }
+}
+
+/* Insert a new node for @key with room for @extra inline bytes after it. */
+static inline struct hash_key *map_insert(map_t *map, int key, size_t extra)
+{
+    if (map->old_ht)
+        map_rehash_step(map, MAP_REHASH_STEP);
+
+    /* Straight to the chains: map_bloom_stats() counts lookups only. */
+    size_t probes = 0;
+    if (map_find_chain(map, key, &probes))
+        return NULL;
+
+    if (map->count >= (size_t) MAP_HASH_SIZE(map->bits) * MAP_MAX_LOAD &&
+        map->bits < MAP_MAX_BITS)
+        map_resize(map, map->bits + 1);
+
+    size_t size = (sizeof(struct hash_key) + extra + 15) & ~(size_t) 15;
+    struct hash_key *kn = map_arena_alloc(map, size);
+    if (!kn)
+        return NULL;
+    kn->key = key;
+    kn->owned = false;
+    kn->units = size / 16 <= UINT16_MAX ? size / 16 : 0;
+    kn->data = NULL;
+    hlist_add_head(&kn->node, &map->ht[hash(key, map->bits)]);
+    if (map->bloom)
+        map_bloom_insert(map->bloom, key);
+    map->count++;
+    return kn;
+}
+
+/* Add @key with caller-allocated @data; the map frees it in map_deinit(). */
+static inline void map_add(map_t *map, int key, void *data)
+{
+    struct hash_key *kn = map_insert(map, key, 0);
+    if (!kn)
+        return;
+
+    kn->data = data;
+    if (data) {
+        kn->owned = true;
+        map->owned++;
+    }
+}
+
+/**
+ * map_add_value() - add @key with a copy of @size bytes stored inline
+ *
+ * The value lives right behind the node in the arena, so map_get() returns
+ * a pointer into the same allocation and nothing is malloc()ed per entry.
+ */
+static inline void map_add_value(map_t *map,
+                                 int key,
+                                 const void *value,
+                                 size_t size)
+{
+    struct hash_key *kn = map_insert(map, key, size);
+    if (!kn)
+        return;
+
+    kn->data = kn + 1;
+    memcpy(kn->data, value, size);
+}
+
+/* Free the data map_add() handed over; nodes themselves live in chunks. */
+static inline void map_free_owned(struct hlist_head *ht, int bits)
+{
+    for (int i = 0; i < MAP_HASH_SIZE(bits); i++) {
+        for (struct hlist_node *p = ht[i].first; p; p = p->next) {
+            struct hash_key *kn = container_of(p, struct hash_key, node);
+            if (kn->owned)
+                free(kn->data);
+        }
+    }
+}
+
+static inline void map_free_chunks(struct map_chunk *c)
+{
+    for (struct map_chunk *next; c; c = next) {
+        next = c->next;
+        free(c);
+    }
+}
+
+static inline void map_deinit(map_t *map)
+{
+    if (!map)
+        return;
+
+    if (map->owned) {
+        if (map->old_ht)
+            map_free_owned(map->old_ht, map->old_bits);
+        map_free_owned(map->ht, map->bits);
+    }
+
+    if (map->old_ht)
+        map_free_table_mem(map->old_ht, map->old_bits);
+    map_free_table_mem(map->ht, map->bits);
+    map_free_chunks(map->chunks);
+    map_free_chunks(map->spare);
+    map_bloom_free(map->bloom);
+    free(map);
+}
+
+/**
+ * map_del_node() - remove @kn, a node still linked into @map
+ *
+ * For callers that kept the node from map_insert() or a lookup: no hashing
+ * and no chain walk, just the unlink through @pprev.
+ */
+static inline void map_del_node(map_t *map, struct hash_key *kn)
+{
+    hlist_del(&kn->node);
+    if (kn->owned) {
+        free(kn->data);
+        map->owned--;
+    }
+    if (kn->units && kn->units < MAP_FREE_CLASSES) {
+        kn->node.next = map->free[kn->units];
+        map->free[kn->units] = &kn->node;
+    }
+    map->count--;
+}
+
+/**
+ * map_del() - remove @key, returning whether it was present
+ *
+ * The node unlinks itself through @pprev in O(1) once found, without
+ * walking back over its chain. Data handed over with map_add() is freed, and
+ * the node goes on a free list for the next insert of the same size.
+ */
+static inline bool map_del(map_t *map, int key)
+{
+    if (map->old_ht)
+        map_rehash_step(map, MAP_REHASH_STEP);
+
+    struct hash_key *kn = find_key(map, key);
+    if (!kn)
+        return false;
+    map_del_node(map, kn);
+    return true;
+}
+
+/**
+ * map_clear() - drop every entry but keep the map's memory for reuse
+ *
+ * Buckets are zeroed in place and chunks move to the spare list, so refilling
+ * a cleared map neither reallocates the table nor calls malloc() for nodes
+ * until it outgrows what it held before. Chunks larger than MAP_CHUNK_SIZE
+ * were dedicated to one oversized value and are freed.
+ */
+static inline void map_clear(map_t *map)
+{
+    if (map->owned) {
+        if (map->old_ht)
+            map_free_owned(map->old_ht, map->old_bits);
+        map_free_owned(map->ht, map->bits);
+        map->owned = 0;
+    }
+    if (map->old_ht) {
+        map_free_table_mem(map->old_ht, map->old_bits);
+        map->old_ht = NULL;
+    }
+    memset(map->ht, 0, sizeof(struct hlist_head) * MAP_HASH_SIZE(map->bits));
+
+    for (struct map_chunk *c = map->chunks, *next; c; c = next) {
+        next = c->next;
+        if (c->size > MAP_CHUNK_SIZE) {
+            free(c);
+        } else {
+            c->next = map->spare;
+            map->spare = c;
+        }
+    }
+    map->chunks = NULL;
+    memset(map->free, 0, sizeof(map->free));
+    map->count = 0;
+    if (map->bloom)
+        memset(map->bloom->blocks, 0,
+               sizeof(*map->bloom->blocks) << map->bloom->bits);
+}
+
+/**
+ * struct map_iter - cursor over every entry of a map_t
+ *
+ * The next node is fetched before the current one is handed out, so the
+ * loop body may map_del() the entry it is looking at. map_iter_init()
+ * finishes any running rehash so that entries sit in one table; inserting
+ * while iterating is not supported, since it may start a new one.
+ */
+struct map_iter {
+    map_t *map;
+    size_t bucket;
+    struct hlist_node *next;
+};
+
+static inline void map_iter_init(map_t *map, struct map_iter *it)
+{
+    map_rehash_finish(map);
+    it->map = map;
+    it->bucket = 0;
+    it->next = NULL;
+}
+
+static inline struct hash_key *map_iter_next(struct map_iter *it)
+{
+    size_t size = MAP_HASH_SIZE(it->map->bits);
+
+    while (!it->next) {
+        if (it->bucket == size)
+            return NULL;
+        it->next = it->map->ht[it->bucket++].first;
+    }
+
+    struct hlist_node *p = it->next;
+    it->next = p->next;
+    return container_of(p, struct hash_key, node);
+}
+
+#define map_for_each_safe(kn, it, map) \
+    for (map_iter_init(map, it); ((kn) = map_iter_next(it));)
+
+/* Bloom filter bits per key; 10 gives about 1% false positives. */
+#ifndef MAP_BLOOM_BITS_PER_KEY
+#define MAP_BLOOM_BITS_PER_KEY 10
+#endif
+
+static inline void map_bloom_add_table(struct map_bloom *b,
+                                       struct hlist_head *ht,
+                                       size_t from,
+                                       size_t to)
+{
+    for (size_t i = from; i < to; i++) {
+        for (struct hlist_node *p = ht[i].first; p; p = p->next)
+            map_bloom_insert(b, container_of(p, struct hash_key, node)->key);
+    }
+}
+
+/**
+ * map_bloom_enable() - filter negative lookups of @map for @capacity keys
+ *
+ * Sizes the filter at MAP_BLOOM_BITS_PER_KEY bits per key, rounded up to a
+ * power of two of blocks, and adds the keys already in the map. The filter
+ * does not grow with the map; once map->count passes @capacity the false
+ * positive rate climbs, and calling this again rebuilds it larger.
+ */
+static inline bool map_bloom_enable(map_t *map, size_t capacity)
+{
+    struct map_bloom *b = malloc(sizeof(struct map_bloom));
+    if (!b)
+        return false;
+
+    if (capacity < map->count)
+        capacity = map->count;
+    b->bits = 1; /* keeps the block shift below 64 */
+    while (b->bits < 40 &&
+           ((size_t) 512 << b->bits) < capacity * MAP_BLOOM_BITS_PER_KEY)
+        b->bits++;
+    b->blocks = aligned_alloc(64, sizeof(*b->blocks) << b->bits);
+    if (!b->blocks) {
+        free(b);
+        return false;
+    }
+    memset(b->blocks, 0, sizeof(*b->blocks) << b->bits);
+    b->capacity = capacity;
+    b->queries = b->negatives = b->false_pos = 0;
+
+    map_bloom_add_table(b, map->ht, 0, MAP_HASH_SIZE(map->bits));
+    if (map->old_ht)
+        map_bloom_add_table(b, map->old_ht, map->rehash_idx,
+                            MAP_HASH_SIZE(map->old_bits));
+    map_bloom_free(map->bloom);
+    map->bloom = b;
+    return true;
+}
+
+static inline void map_bloom_disable(map_t *map)
+{
+    map_bloom_free(map->bloom);
+    map->bloom = NULL;
+}
+
+/**
+ * map_bloom_fpr() - false-positive rate of the filter
+ * @measured: set to the observed rate over absent keys looked up so far,
+ *            or -1 when none has been seen yet
+ *
+ * Returns the rate a blocked filter with the current fill should have, from
+ * the fraction of set bits; every one of a key's eight words must match.
+ */
+static inline double map_bloom_fpr(const map_t *map, double *measured)
+{
+    const struct map_bloom *b = map->bloom;
+    if (!b)
+        return 0.0;
+
+    size_t absent = b->negatives + b->false_pos;
+    if (measured)
+        *measured = absent ? (double) b->false_pos / absent : -1.0;
+
+    size_t set = 0, words = (size_t) 8 << b->bits;
+    for (size_t i = 0; i < words; i++)
+        set += __builtin_popcountll(b->blocks[i / 8][i % 8]);
+    double fill = (double) set / (words * 64);
+    double p = fill * fill;
+    p *= p;
+    return p * p; /* fill^8 */
+}
+
+static inline void map_bloom_print(const map_t *map, const char *name)
+{
+    const struct map_bloom *b = map->bloom;
+    if (!b)
+        return;
+
+    double measured;
+    double expected = map_bloom_fpr(map, &measured);
+    fprintf(stderr,
+            "[map] %s: bloom %zu KiB for %zu keys, queries=%zu rejected=%zu "
+            "false_pos=%zu fpr=%.4f (expected %.4f)\n",
+            name, (sizeof(*b->blocks) << b->bits) >> 10, b->capacity,
+            b->queries, b->negatives, b->false_pos, measured, expected);
+}
+
+/* Chain lengths 0 .. MAP_STATS_HIST - 2; the last bin collects longer ones. */
+#ifndef MAP_STATS_HIST
+#define MAP_STATS_HIST 8
+#endif
+
+/**
+ * struct map_stats - shape of the table, as computed by map_stats()
+ *
+ * The probe averages assume lookups spread like the stored keys: a hit on
+ * the i-th node of a chain compares i keys, and a miss walks a whole chain
+ * picked uniformly among the buckets. Live numbers for the actual lookup
+ * mix come from map_stats_sample().
+ */
+struct map_stats {
+    size_t buckets, entries, empty;
+    double load_factor, empty_ratio;
+    size_t longest_chain;
+    size_t hist[MAP_STATS_HIST];
+    double probes_per_hit, probes_per_miss;
+};
+
+static inline void map_stats_table(struct map_stats *st,
+                                   struct hlist_head *ht,
+                                   size_t from,
+                                   size_t to,
+                                   size_t *hit_probes)
+{
+    for (size_t i = from; i < to; i++) {
+        size_t len = 0;
+        for (struct hlist_node *p = ht[i].first; p; p = p->next)
+            len++;
+        st->buckets++;
+        st->entries += len;
+        st->empty += !len;
+        if (len > st->longest_chain)
+            st->longest_chain = len;
+        st->hist[len < MAP_STATS_HIST - 1 ? len : MAP_STATS_HIST - 1]++;
+        *hit_probes += len * (len + 1) / 2;
+    }
+}
+
+/* Walk every bucket of @map; O(buckets + entries), meant for diagnostics. */
+static inline void map_stats(map_t *map, struct map_stats *st)
+{
+    size_t hit_probes = 0;
+
+    *st = (struct map_stats){0};
+    map_stats_table(st, map->ht, 0, MAP_HASH_SIZE(map->bits), &hit_probes);
+    /* Mid-rehash, the unmigrated old buckets hold entries too. */
+    if (map->old_ht)
+        map_stats_table(st, map->old_ht, map->rehash_idx,
+                        MAP_HASH_SIZE(map->old_bits), &hit_probes);
+
+    st->load_factor = (double) st->entries / MAP_HASH_SIZE(map->bits);
+    st->empty_ratio = (double) st->empty / st->buckets;
+    st->probes_per_hit =
+        st->entries ? (double) hit_probes / st->entries : 0.0;
+    st->probes_per_miss = (double) st->entries / st->buckets;
+}
+
+/**
+ * map_stats_sample() - count probes of every @every-th map_get()
+ *
+ * Unsampled lookups pay one predictable branch. Pass 0 to stop sampling;
+ * the counters in @map->sampled are reset either way.
+ */
+static inline void map_stats_sample(map_t *map, size_t every)
+{
+    map->sample_every = every;
+    map->sample_tick = 0;
+    map->sampled = (struct map_probe_stats){0, 0, 0, 0};
+}
+
+static inline void map_stats_print(map_t *map, const char *name)
+{
+    struct map_stats st;
+    map_stats(map, &st);
+
+    fprintf(stderr,
+            "[map] %s: entries=%zu buckets=%zu load=%.2f empty=%.1f%% "
+            "longest=%zu probes/hit=%.2f probes/miss=%.2f\n",
+            name, st.entries, st.buckets, st.load_factor,
+            st.empty_ratio * 100, st.longest_chain, st.probes_per_hit,
+            st.probes_per_miss);
+    fprintf(stderr, "[map] %s: chains", name);
+    for (int i = 0; i < MAP_STATS_HIST; i++)
+        fprintf(stderr, " %d%s:%zu", i, i == MAP_STATS_HIST - 1 ? "+" : "",
+                st.hist[i]);
+    fprintf(stderr, "\n");
+
+    const struct map_probe_stats *s = &map->sampled;
+    if (s->hits + s->misses)
+        fprintf(stderr,
+                "[map] %s: sampled hits=%zu (%.2f probes) misses=%zu "
+                "(%.2f probes)\n",
+                name, s->hits,
+                s->hits ? (double) s->hit_probes / s->hits : 0.0, s->misses,
+                s->misses ? (double) s->miss_probes / s->misses : 0.0);
+}
@@ -0,0 +1,93 @@
+/* Scalar map_get() against map_get_batch() on tables of growing size
+ *
+ * Build: gcc -O2 -o map_batch_bench map_batch_bench.c
+ * Usage: ./map_batch_bench [max_keys] [batch]
+ *
+ * Half of the lookups hit and half miss, in random order. Once nodes and
+ * buckets outgrow the last-level cache every scalar lookup waits on two or
+ * more dependent misses, which is where the batched path should pull ahead.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "map.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void shuffle(int *a, size_t n)
+{
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = ((size_t) rand() << 16 ^ rand()) % (i + 1);
+        int t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+    }
+}
+
+static void run(size_t n, size_t batch)
+{
+    map_t *map = map_init(10);
+    int *keys = malloc(sizeof(int) * 2 * n);
+    void **out = malloc(sizeof(void *) * batch);
+    assert(map && keys && out);
+
+    for (size_t i = 0; i < n; i++) {
+        int v = (int) i;
+        keys[2 * i] = (int) ((2 * i + 1) * 2654435761u); /* hit */
+        keys[2 * i + 1] = (int) (2 * i * 2654435761u);   /* miss */
+        map_add_value(map, keys[2 * i], &v, sizeof(v));
+    }
+    map_rehash_finish(map);
+    shuffle(keys, 2 * n);
+
+    long found = 0;
+    double t0 = now();
+    for (size_t i = 0; i < 2 * n; i++)
+        found += map_get(map, keys[i]) != NULL;
+    double t_scalar = now() - t0;
+    assert(found == (long) n);
+
+    found = 0;
+    t0 = now();
+    for (size_t i = 0; i < 2 * n; i += batch) {
+        size_t m = 2 * n - i < batch ? 2 * n - i : batch;
+        map_get_batch(map, keys + i, out, m);
+        for (size_t j = 0; j < m; j++)
+            found += out[j] != NULL;
+    }
+    double t_batch = now() - t0;
+    assert(found == (long) n);
+
+    double ns = 1e9 / (2 * n);
+    printf("%10zu %8.1f MiB %10.1f %10.1f %8.2fx\n", n,
+           (n * 48.0 + MAP_HASH_SIZE(map->bits) * 8.0) / (1 << 20),
+           t_scalar * ns, t_batch * ns, t_scalar / t_batch);
+
+    map_deinit(map);
+    free(keys);
+    free(out);
+}
+
+int main(int argc, char **argv)
+{
+    size_t max = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 24;
+    size_t batch = argc > 2 ? strtoul(argv[2], NULL, 10) : 1024;
+    if (!batch)
+        return 1;
+
+    printf("%10s %12s %10s %10s %9s   (ns/lookup, batch=%zu, width=%d)\n",
+           "keys", "footprint", "scalar", "batched", "speedup", batch,
+           MAP_BATCH_WIDTH);
+    for (size_t n = 1 << 12; n <= max; n *= 4)
+        run(n, batch);
+    return 0;
+}
@@ -0,0 +1,88 @@
+/* Miss-heavy map_get() with and without the Bloom prefilter
+ *
+ * Build: gcc -O2 -mavx2 -o map_bloom_bench map_bloom_bench.c
+ * Usage: ./map_bloom_bench [keys] [lookups]
+ *
+ * Lookups draw from stored keys with the given hit ratio and from absent
+ * keys otherwise, as twoSum() sees them: most complements are not there.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "map.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t xorshift64(uint64_t *s)
+{
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+/* Odd multiples are stored, even ones never are. */
+static inline int key_of(size_t i, bool hit)
+{
+    return (int) ((2 * i + hit) * 2654435761u);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 22;
+    size_t m = argc > 2 ? strtoul(argv[2], NULL, 10) : 1 << 24;
+    int *keys = malloc(sizeof(int) * m);
+    map_t *map = map_init(10);
+    assert(keys && map);
+
+    for (size_t i = 0; i < n; i++) {
+        int v = (int) i;
+        map_add_value(map, key_of(i, true), &v, sizeof(v));
+    }
+    map_rehash_finish(map);
+
+    static const int hit_pcts[] = {50, 10, 1};
+    printf("keys = %zu, %zu lookups, ns/lookup\n", n, m);
+    for (size_t k = 0; k < sizeof(hit_pcts) / sizeof(hit_pcts[0]); k++) {
+        uint64_t seed = 0x2545F4914F6CDD1DULL;
+        size_t expect = 0;
+        for (size_t i = 0; i < m; i++) {
+            uint64_t r = xorshift64(&seed);
+            bool hit = (int) (r % 100) < hit_pcts[k];
+            expect += hit;
+            keys[i] = key_of((r >> 8) % n, hit);
+        }
+
+        double t[2];
+        for (int bloom = 0; bloom < 2; bloom++) {
+            if (bloom)
+                map_bloom_enable(map, n);
+            else
+                map_bloom_disable(map);
+
+            size_t found = 0;
+            double t0 = now();
+            for (size_t i = 0; i < m; i++)
+                found += map_get(map, keys[i]) != NULL;
+            t[bloom] = now() - t0;
+            assert(found == expect);
+        }
+        printf("hits %2d%%: plain %6.1f  bloom %6.1f  (%.2fx)\n", hit_pcts[k],
+               t[0] * 1e9 / m, t[1] * 1e9 / m, t[0] / t[1]);
+        map_bloom_print(map, "bench");
+    }
+
+    map_deinit(map);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/* Steady-state insert/delete churn on map_t
+ *
+ * Build: gcc -O2 -o map_churn map_churn.c
+ * Usage: ./map_churn [live_keys] [rounds]
+ *
+ * The map is filled with @live_keys keys, then every round deletes a random
+ * live key and inserts a fresh one @live_keys times, so the size never
+ * changes. Per-operation latency and the process RSS are printed per round;
+ * both should stay flat once the free lists are primed. A final round clears
+ * the map and refills it, which should reuse the chunks and buckets.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "map.h"
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double rss_mib(void)
+{
+    long pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%*s %ld", &pages) != 1)
+            pages = 0;
+        fclose(f);
+    }
+    return pages * (double) sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static inline uint64_t xorshift64(uint64_t *s)
+{
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+static void report(const char *name, uint32_t *lat, size_t n, map_t *map)
+{
+    qsort(lat, n, sizeof(uint32_t), cmp_u32);
+    printf("%-10s p50=%4u p99=%5u p99.9=%6u max=%8u ns  entries=%zu "
+           "rss=%.1f MiB\n",
+           name, lat[n / 2], lat[n / 100 * 99], lat[n / 1000 * 999],
+           lat[n - 1], map->count, rss_mib());
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 20;
+    int rounds = argc > 2 ? atoi(argv[2]) : 8;
+    map_t *map = map_init(10);
+    int *live = malloc(sizeof(int) * n);
+    uint32_t *lat = malloc(sizeof(uint32_t) * n);
+    if (!map || !live || !lat || n < 1000)
+        return 1;
+
+    /* Keys are a counter scrambled by an odd multiplier: never repeated. */
+    uint32_t next = 0;
+    for (size_t i = 0; i < n; i++) {
+        live[i] = (int) (next++ * 2654435761u);
+        int v = (int) i;
+        map_add_value(map, live[i], &v, sizeof(v));
+    }
+    printf("filled     entries=%zu rss=%.1f MiB\n", map->count, rss_mib());
+
+    uint64_t seed = 88172645463325252ULL;
+    char name[24];
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            size_t victim = xorshift64(&seed) % n;
+            int v = (int) i;
+            uint64_t t0 = now_ns();
+            map_del(map, live[victim]);
+            live[victim] = (int) (next++ * 2654435761u);
+            map_add_value(map, live[victim], &v, sizeof(v));
+            uint64_t t1 = now_ns();
+            lat[i] = t1 - t0 > UINT32_MAX ? UINT32_MAX : (uint32_t) (t1 - t0);
+        }
+        snprintf(name, sizeof(name), "round %d", r);
+        report(name, lat, n, map);
+    }
+
+    /* Iterate and delete every other entry, then clear and refill. */
+    struct map_iter it;
+    struct hash_key *kn;
+    size_t seen = 0, left = map->count;
+    map_for_each_safe(kn, &it, map)
+    {
+        if (seen++ & 1)
+            map_del(map, kn->key);
+    }
+    printf("iterated   %zu entries, %zu left after deleting every other\n",
+           seen, map->count);
+    if (seen != left)
+        return 1;
+
+    map_clear(map);
+    for (size_t i = 0; i < n; i++) {
+        int v = (int) i;
+        uint64_t t0 = now_ns();
+        map_add_value(map, (int) (next++ * 2654435761u), &v, sizeof(v));
+        uint64_t t1 = now_ns();
+        lat[i] = t1 - t0 > UINT32_MAX ? UINT32_MAX : (uint32_t) (t1 - t0);
+    }
+    report("refill", lat, n, map);
+
+    map_deinit(map);
+    free(live);
+    free(lat);
+    return 0;
+}
@@ -0,0 +1,72 @@
+/* Show how hash() spreads a few typical key spaces over map_t buckets
+ *
+ * Build: gcc -O2 -o map_health map_health.c
+ * Usage: ./map_health [keys]
+ *
+ * Each pattern inserts @keys keys, then runs sampled lookups (every 7th
+ * map_get()) over the same number of hits and misses. A multiplicative hash
+ * copes with power-of-two strides, but a stride whose product with
+ * GOLDEN_RATIO_32 is a small power of two moves every key by the same tiny
+ * amount in the top bits, so runs of consecutive IDs pile into one bucket.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "map.h"
+
+/* Inverse of GOLDEN_RATIO_32 modulo 2^32, by Newton iteration. */
+static uint32_t golden_inverse(void)
+{
+    uint32_t x = GOLDEN_RATIO_32;
+    for (int i = 0; i < 5; i++)
+        x *= 2 - GOLDEN_RATIO_32 * x;
+    return x;
+}
+
+static int key_of(int pattern, size_t i)
+{
+    switch (pattern) {
+    case 0:
+        return (int) i;
+    case 1:
+        return (int) (i * 64);
+    case 2:
+        return (int) ((uint32_t) i * (golden_inverse() << 12));
+    default:
+        return (int) ((uint32_t) rand() << 16 ^ (uint32_t) rand());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 16;
+    static const char *names[] = {"sequential", "stride 64", "bad stride",
+                                  "random"};
+
+    for (int k = 0; k < 4; k++) {
+        map_t *map = map_init(10);
+        int *keys = malloc(sizeof(int) * n);
+        if (!map || !keys)
+            return 1;
+
+        srand(1);
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = key_of(k, i);
+            map_add(map, keys[i], NULL);
+        }
+        map_rehash_finish(map);
+
+        map_stats_sample(map, 7);
+        for (size_t i = 0; i < n; i++) {
+            map_get(map, keys[i]);
+            map_get(map, keys[i] ^ 0x40000000); /* mostly misses */
+        }
+        map_stats_print(map, names[k]);
+
+        free(keys);
+        map_deinit(map);
+    }
+    return 0;
+}
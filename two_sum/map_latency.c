@@ -0,0 +1,65 @@
+/* Per-insert latency of map_add() while the map grows
+ *
+ * Build: gcc -O2 -o map_latency map_latency.c
+ * Usage: ./map_latency [keys]
+ *
+ * The same insert sequence runs twice: once with the incremental rehash in
+ * map.h, and once finishing every rehash inside the insert that triggered
+ * it, which is what a stop-the-world resize would cost.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "map.h"
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static void run(const char *name, size_t n, uint32_t *lat, bool stop_world)
+{
+    map_t *map = map_init(10);
+    uint64_t start = now_ns();
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t t0 = now_ns();
+        map_add(map, (int) (i * 2654435761u), NULL);
+        if (stop_world)
+            map_rehash_finish(map);
+        uint64_t t1 = now_ns();
+        lat[i] = t1 - t0 > UINT32_MAX ? UINT32_MAX : (uint32_t) (t1 - t0);
+    }
+    double total = (now_ns() - start) * 1e-9;
+
+    qsort(lat, n, sizeof(uint32_t), cmp_u32);
+    printf("%-14s %6.2f s  p50=%u p99=%u p99.9=%u p99.99=%u max=%u ns "
+           "buckets=2^%d\n",
+           name, total, lat[n / 2], lat[n / 100 * 99], lat[n / 1000 * 999],
+           lat[n / 10000 * 9999], lat[n - 1], map->bits);
+    map_deinit(map);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+    uint32_t *lat = malloc(sizeof(uint32_t) * n);
+    if (!lat || n < 1000)
+        return 1;
+
+    run("incremental", n, lat, false);
+    run("stop-the-world", n, lat, true);
+    free(lat);
+    return 0;
+}
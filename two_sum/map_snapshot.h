@@ -0,0 +1,274 @@
+/* Flat, mmap-able snapshots of a map_t for read-only lookups */
+
+#pragma once
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "map.h"
+
+/**
+ * Snapshot file layout, in host byte order, every section 64-byte aligned:
+ *
+ *   struct map_snap_header
+ *   uint32_t start[2^bits + 1]   bucket b owns entries [start[b], start[b+1])
+ *   int32_t  keys[count]         grouped by bucket
+ *   uint8_t  values[count][value_size]
+ *
+ * There are no pointers, only offsets from the start of the file, so the
+ * file is position independent: map_snapshot_open() maps it and lookups run
+ * directly on the mapped pages. Chains become contiguous runs of keys, which
+ * a lookup scans without chasing next pointers. Buckets use the same hash()
+ * and bit count as the map that was saved.
+ *
+ * Values are opaque bytes that cannot be converted, so nothing is: the
+ * header records the writer's byte order and map_snapshot_open() refuses a
+ * file from a host of the other endianness.
+ *
+ * The header checksum covers the header itself and is always checked, along
+ * with the section bounds and start[], so that no lookup can leave the
+ * mapping even in a file crafted with valid checksums. The payload
+ * checksum covers everything after the header; checking it reads the whole
+ * file, so map_snapshot_open() only does so on request. Skip it only for
+ * files this process family wrote itself.
+ */
+
+#define MAP_SNAP_MAGIC "MAPSNAP\0"
+#define MAP_SNAP_VERSION 2
+#define MAP_SNAP_BYTE_ORDER 0x0102030405060708ULL
+
+struct map_snap_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t bits;
+    uint64_t byte_order; /* MAP_SNAP_BYTE_ORDER, as the writer stored it */
+    uint64_t count;
+    uint64_t value_size;
+    uint64_t start_off, keys_off, values_off, file_size;
+    uint64_t payload_sum;
+    uint64_t header_sum; /* over the bytes above */
+} __attribute__((aligned(64)));
+
+typedef struct {
+    const struct map_snap_header *hdr;
+    const uint32_t *start;
+    const int32_t *keys;
+    const uint8_t *values;
+    size_t size;
+} map_snap_t;
+
+/* Word-at-a-time multiply/rotate checksum: cheap enough for whole files. */
+static inline uint64_t map_snap_checksum(const void *p, size_t len)
+{
+    const uint8_t *b = p;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+
+    for (; len >= 8; b += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, b, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    for (; len; b++, len--)
+        h = (h ^ *b) * 0x100000001b3ULL;
+    return h ^ (h >> 29);
+}
+
+static inline uint64_t map_snap_align(uint64_t off)
+{
+    return (off + 63) & ~(uint64_t) 63;
+}
+
+/**
+ * map_snapshot_save() - write @map to @path
+ * @value_size: bytes copied from each entry's data; entries with NULL data
+ *              are stored as zeros. 0 saves the keys only.
+ *
+ * The file is built under "@path.tmp" and renamed into place, so readers
+ * never see a half-written snapshot. Finishes any running rehash first.
+ */
+static inline bool map_snapshot_save(map_t *map,
+                                     const char *path,
+                                     size_t value_size)
+{
+    map_rehash_finish(map);
+    if (map->count > UINT32_MAX)
+        return false;
+
+    size_t nb = MAP_HASH_SIZE(map->bits);
+    struct map_snap_header h = {.magic = MAP_SNAP_MAGIC,
+                                .version = MAP_SNAP_VERSION,
+                                .bits = (uint32_t) map->bits,
+                                .byte_order = MAP_SNAP_BYTE_ORDER,
+                                .count = map->count,
+                                .value_size = value_size};
+    h.start_off = map_snap_align(sizeof(h));
+    h.keys_off = map_snap_align(h.start_off + (nb + 1) * sizeof(uint32_t));
+    h.values_off = map_snap_align(h.keys_off + map->count * sizeof(int32_t));
+    h.file_size = map_snap_align(h.values_off + map->count * value_size);
+
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int) sizeof(tmp))
+        return false;
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, (off_t) h.file_size)) {
+        close(fd);
+        unlink(tmp);
+        return false;
+    }
+    uint8_t *base = mmap(NULL, h.file_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        unlink(tmp);
+        return false;
+    }
+
+    uint32_t *start = (uint32_t *) (base + h.start_off);
+    int32_t *keys = (int32_t *) (base + h.keys_off);
+    uint8_t *values = base + h.values_off;
+    uint32_t n = 0;
+    for (size_t b = 0; b < nb; b++) {
+        start[b] = n;
+        for (struct hlist_node *p = map->ht[b].first; p; p = p->next) {
+            struct hash_key *kn = container_of(p, struct hash_key, node);
+            keys[n] = kn->key;
+            if (value_size && kn->data)
+                memcpy(values + (size_t) n * value_size, kn->data, value_size);
+            n++;
+        }
+    }
+    start[nb] = n;
+
+    h.payload_sum = map_snap_checksum(base + sizeof(h),
+                                      h.file_size - sizeof(h));
+    h.header_sum = map_snap_checksum(&h, offsetof(struct map_snap_header,
+                                                  header_sum));
+    memcpy(base, &h, sizeof(h));
+
+    bool ok = msync(base, h.file_size, MS_SYNC) == 0;
+    munmap(base, h.file_size);
+    if (!ok || rename(tmp, path)) {
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+/* Whether @n items of @each bytes at @off fit in [@lo, @hi), 64-byte aligned,
+ * without any of the arithmetic overflowing.
+ */
+static inline bool map_snap_fits(uint64_t off,
+                                 uint64_t n,
+                                 uint64_t each,
+                                 uint64_t lo,
+                                 uint64_t hi)
+{
+    return off >= lo && off <= hi && off % 64 == 0 &&
+           (each == 0 || n <= (hi - off) / each);
+}
+
+/* Bucket bounds must ascend and end at @count for every run to stay inside
+ * keys[] and values[].
+ */
+static inline bool map_snap_starts_ok(const uint32_t *start,
+                                      size_t nb,
+                                      uint64_t count)
+{
+    for (size_t b = 0; b < nb; b++) {
+        if (start[b] > start[b + 1])
+            return false;
+    }
+    return start[nb] == count;
+}
+
+/* Map @path read-only; NULL if it is missing, corrupt, another version or
+ * written by a host of the other byte order.
+ */
+static inline map_snap_t *map_snapshot_open(const char *path, bool verify)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) ||
+        (size_t) st.st_size < sizeof(struct map_snap_header)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t) st.st_size;
+    const uint8_t *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    const struct map_snap_header *h = (const void *) base;
+    bool ok = !memcmp(h->magic, MAP_SNAP_MAGIC, 8) &&
+              h->version == MAP_SNAP_VERSION &&
+              h->byte_order == MAP_SNAP_BYTE_ORDER &&
+              h->header_sum ==
+                  map_snap_checksum(h, offsetof(struct map_snap_header,
+                                                header_sum)) &&
+              h->file_size == size && h->bits <= MAP_MAX_BITS &&
+              h->count <= UINT32_MAX &&
+              map_snap_fits(h->start_off,
+                            (uint64_t) MAP_HASH_SIZE(h->bits) + 1, 4,
+                            sizeof(*h), h->keys_off) &&
+              map_snap_fits(h->keys_off, h->count, 4, h->keys_off,
+                            h->values_off) &&
+              map_snap_fits(h->values_off, h->count, h->value_size,
+                            h->values_off, size) &&
+              map_snap_starts_ok((const uint32_t *) (base + h->start_off),
+                                 MAP_HASH_SIZE(h->bits), h->count);
+    if (ok && verify)
+        ok = h->payload_sum == map_snap_checksum(base + sizeof(*h),
+                                                 size - sizeof(*h));
+    map_snap_t *snap = ok ? malloc(sizeof(map_snap_t)) : NULL;
+    if (!snap) {
+        munmap((void *) base, size);
+        return NULL;
+    }
+
+    snap->hdr = h;
+    snap->start = (const uint32_t *) (base + h->start_off);
+    snap->keys = (const int32_t *) (base + h->keys_off);
+    snap->values = base + h->values_off;
+    snap->size = size;
+    return snap;
+}
+
+/**
+ * map_snapshot_get() - look up @key in a mapped snapshot
+ *
+ * Returns a pointer to its value_size bytes in the mapping, or to the key
+ * itself for key-only snapshots; NULL when absent.
+ */
+static inline const void *map_snapshot_get(const map_snap_t *snap, int key)
+{
+    size_t b = hash(key, snap->hdr->bits);
+    for (uint32_t i = snap->start[b], end = snap->start[b + 1]; i < end; i++) {
+        if (snap->keys[i] == key)
+            return snap->hdr->value_size
+                       ? snap->values + (size_t) i * snap->hdr->value_size
+                       : (const void *) &snap->keys[i];
+    }
+    return NULL;
+}
+
+static inline void map_snapshot_close(map_snap_t *snap)
+{
+    if (!snap)
+        return;
+    munmap((void *) snap->hdr, snap->size);
+    free(snap);
+}
@@ -0,0 +1,571 @@
+/* Micro-benchmark suite for every int-keyed map in this directory
+ *
+ * Build: gcc -O2 -msse2 -pthread -o map_suite map_suite.c -lm
+ * Usage: ./map_suite [max_mib] [ops]
+ *
+ * For each key distribution and map size, every map variant is filled and
+ * then timed on:
+ *
+ *   insert  add every key to an empty map, growth included
+ *   hit     look up keys that are present
+ *   miss    look up keys that are absent
+ *   mixed   80% hits, 20% in-place value updates
+ *   churn   delete a random live key and insert a fresh one (one op)
+ *
+ * Distributions: uniform (scrambled, distinct), sequential (0, 1, 2, ...),
+ * strided (multiples of 64) and zipf, which inserts the uniform keys but
+ * draws hits with a Zipf(0.99) skew so a few hot keys take most lookups.
+ * Sizes grow by 4x from 1024 keys, and the last one is exactly @max_mib at
+ * a nominal 48 bytes per key: by default ten times the last-level cache,
+ * capped at a quarter of physical memory and at the 2^26 key indices that
+ * strided keys can take while staying distinct. Results are ns/op, and the
+ * bytes each map holds per entry once filled; "-" marks operations a
+ * variant does not have.
+ *
+ * The variants are map_t as main.c uses it, map_t with its Bloom filter,
+ * swiss_map_t, the concurrent cmap_t used by one thread, and gmap with
+ * three hash functions: Fibonacci multiply, murmur3's fmix64 and wyhash.
+ */
+
+#include <assert.h>
+#include <malloc.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cmap.h"
+#include "gmap.h"
+#include "map.h"
+#include "swiss_map.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t xorshift64(uint64_t *s)
+{
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+/* murmur3's 32-bit finaliser: a bijection, so distinct in, distinct out. */
+static inline uint32_t fmix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    return h ^ (h >> 16);
+}
+
+static inline uint64_t fmix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+static inline uint64_t hash_fib(int key)
+{
+    return gmap_hash_u64((uint32_t) key);
+}
+
+static inline uint64_t hash_fmix(int key)
+{
+    return fmix64((uint32_t) key);
+}
+
+static inline uint64_t hash_wy(int key)
+{
+    return GMAP_HASH_BYTES(key);
+}
+
+GMAP_DEFINE(gfib, int, int, hash_fib, GMAP_EQ)
+GMAP_DEFINE(gfmix, int, int, hash_fmix, GMAP_EQ)
+GMAP_DEFINE(gwy, int, int, hash_wy, GMAP_EQ)
+
+/*
+ * Adapters: every variant provides name_create(n), name_destroy(m),
+ * name_add(m, key, val), name_get(m, key, &val), name_update(m, key, val),
+ * name_del(m, key) and name_bytes(m). Operations a variant lacks are never
+ * called; SUITE_DEFINE() below is told which ones exist.
+ */
+
+static inline size_t hl_bytes(map_t *m)
+{
+    size_t bytes = sizeof(map_t) +
+                   (size_t) MAP_HASH_SIZE(m->bits) * sizeof(struct hlist_head);
+    for (struct map_chunk *c = m->chunks; c; c = c->next)
+        bytes += sizeof(struct map_chunk) + c->size;
+    for (struct map_chunk *c = m->spare; c; c = c->next)
+        bytes += sizeof(struct map_chunk) + c->size;
+    if (m->bloom)
+        bytes += ((size_t) 1 << m->bloom->bits) * 64;
+    return bytes;
+}
+
+static inline map_t *hl_create(size_t n)
+{
+    (void) n;
+    return map_init(10);
+}
+
+static inline void hl_destroy(map_t *m)
+{
+    map_deinit(m);
+}
+
+static inline void hl_add(map_t *m, int key, int val)
+{
+    map_add_value(m, key, &val, sizeof(val));
+}
+
+static inline bool hl_get(map_t *m, int key, int *val)
+{
+    int *p = map_get(m, key);
+    if (p)
+        *val = *p;
+    return p;
+}
+
+static inline void hl_update(map_t *m, int key, int val)
+{
+    int *p = map_get(m, key);
+    if (p)
+        *p = val;
+}
+
+static inline void hl_del(map_t *m, int key)
+{
+    map_del(m, key);
+}
+
+/* map_t with a filter sized for the keys to come, as twoSum() sets it up. */
+static inline map_t *hlb_create(size_t n)
+{
+    map_t *m = map_init(10);
+    if (m && !map_bloom_enable(m, n)) {
+        map_deinit(m);
+        return NULL;
+    }
+    return m;
+}
+
+#define hlb_destroy hl_destroy
+#define hlb_add hl_add
+#define hlb_get hl_get
+#define hlb_update hl_update
+#define hlb_del hl_del
+#define hlb_bytes hl_bytes
+
+/* swiss_map_t stores void * data it frees itself: presence only here. */
+static inline swiss_map_t *sw_create(size_t n)
+{
+    (void) n;
+    return swiss_map_init(10);
+}
+
+static inline void sw_destroy(swiss_map_t *m)
+{
+    swiss_map_deinit(m);
+}
+
+static inline void sw_add(swiss_map_t *m, int key, int val)
+{
+    (void) val;
+    swiss_map_add(m, key, NULL);
+}
+
+static inline bool sw_get(swiss_map_t *m, int key, int *val)
+{
+    long i = swiss_find(m, key, swiss_hash(key));
+    *val = (int) i;
+    return i >= 0;
+}
+
+#define sw_update(m, key, val) ((void) 0)
+#define sw_del(m, key) ((void) 0)
+
+static inline size_t sw_bytes(swiss_map_t *m)
+{
+    return sizeof(swiss_map_t) +
+           ((size_t) 1 << m->bits) * (1 + sizeof(struct swiss_slot));
+}
+
+static struct cmap_thread *cm_self;
+
+static inline cmap_t *cm_create(size_t n)
+{
+    (void) n;
+    cmap_t *m = cmap_init(10);
+    if (m)
+        cm_self = cmap_thread_register(m);
+    return m;
+}
+
+static inline void cm_destroy(cmap_t *m)
+{
+    cmap_thread_unregister(m, cm_self);
+    cmap_deinit(m);
+}
+
+static inline void cm_add(cmap_t *m, int key, int val)
+{
+    cmap_add(m, cm_self, key, val);
+}
+
+static inline bool cm_get(cmap_t *m, int key, int *val)
+{
+    long v = 0;
+    bool found = cmap_get(m, cm_self, key, &v);
+    *val = (int) v;
+    return found;
+}
+
+#define cm_update(m, key, val) ((void) 0)
+
+static inline void cm_del(cmap_t *m, int key)
+{
+    cmap_del(m, cm_self, key);
+}
+
+/* Live chains only; nodes still waiting for reclamation are not counted. */
+static inline size_t cm_bytes(cmap_t *m)
+{
+    struct cmap_table *t = atomic_load(&m->table);
+    size_t n = (size_t) 1 << t->bits;
+    size_t bytes = sizeof(cmap_t) + sizeof(struct cmap_table) +
+                   n * sizeof(struct cmap_node *);
+    for (size_t b = 0; b < n; b++)
+        for (struct cmap_node *p = atomic_load(&t->heads[b]); p;
+             p = atomic_load(&p->next))
+            bytes += malloc_usable_size(p) + sizeof(size_t);
+    return bytes;
+}
+
+#define GSUITE(g)                                                            \
+    static inline g##_t *g##_create(size_t n)                                \
+    {                                                                        \
+        (void) n;                                                            \
+        return g##_init(10);                                                 \
+    }                                                                        \
+                                                                             \
+    static inline void g##_destroy(g##_t *m)                                 \
+    {                                                                        \
+        g##_deinit(m);                                                       \
+    }                                                                        \
+                                                                             \
+    static inline bool g##_getv(g##_t *m, int key, int *val)                 \
+    {                                                                        \
+        int *p = g##_get(m, key);                                            \
+        if (p)                                                               \
+            *val = *p;                                                       \
+        return p;                                                            \
+    }                                                                        \
+                                                                             \
+    static inline void g##_update(g##_t *m, int key, int val)                \
+    {                                                                        \
+        int *p = g##_get(m, key);                                            \
+        if (p)                                                               \
+            *p = val;                                                        \
+    }                                                                        \
+                                                                             \
+    /* gmap has no delete; SUITE_DEFINE() is told so. */                    \
+    static inline void g##_del(g##_t *m, int key)                            \
+    {                                                                        \
+        (void) m;                                                            \
+        (void) key;                                                          \
+    }                                                                        \
+                                                                             \
+    static inline size_t g##_bytes(g##_t *m)                                 \
+    {                                                                        \
+        return sizeof(g##_t) +                                               \
+               ((size_t) 1 << m->bits) * (sizeof(uint32_t) +                 \
+                                          sizeof(g##_slot));                 \
+    }
+
+GSUITE(gfib)
+GSUITE(gfmix)
+GSUITE(gwy)
+
+/* Keys and pre-drawn operations for one distribution and size. */
+struct workload {
+    size_t n, ops;
+    int *keys;       /* insert order */
+    int *hits;       /* @ops present keys, in lookup order */
+    int *misses;     /* @ops absent keys */
+    uint32_t *picks; /* @ops random indices into the live keys, for churn */
+    int *fresh;      /* @ops keys never used otherwise, for churn */
+};
+
+struct result {
+    double insert, hit, miss, mixed, churn; /* ns/op, < 0 when n/a */
+    double bytes;                           /* per entry */
+};
+
+static volatile long sink; /* keeps lookups from being optimised away */
+
+/*
+ * SUITE_DEFINE() - generate run_<name>() timing one variant on a workload
+ * @get:     the name_get()-style lookup to use
+ * @UPDATE:  1 if name_update() exists
+ * @DEL:     1 if name_del() exists
+ *
+ * Every call is a direct call into the variant's inline functions, so the
+ * compiler sees through them exactly as it would in real code; no function
+ * pointers get between the map and the timing loop.
+ */
+#define SUITE_DEFINE(name, T, get, UPDATE, DEL)                              \
+    static void run_##name(const struct workload *w, struct result *r)      \
+    {                                                                        \
+        size_t reps = w->n >= (1 << 18) ? 1 : (1 << 18) / w->n;              \
+        T *m = NULL;                                                         \
+        double t0 = now();                                                   \
+        for (size_t rep = 0; rep < reps; rep++) {                            \
+            if (m)                                                           \
+                name##_destroy(m);                                           \
+            m = name##_create(w->n);                                         \
+            assert(m);                                                       \
+            for (size_t i = 0; i < w->n; i++)                                \
+                name##_add(m, w->keys[i], (int) i);                          \
+        }                                                                    \
+        r->insert = (now() - t0) * 1e9 / ((double) reps * w->n);            \
+        r->bytes = (double) name##_bytes(m) / w->n;                          \
+                                                                             \
+        long found = 0;                                                      \
+        int v = 0;                                                           \
+        t0 = now();                                                          \
+        for (size_t i = 0; i < w->ops; i++)                                  \
+            found += get(m, w->hits[i], &v);                                 \
+        r->hit = (now() - t0) * 1e9 / w->ops;                                \
+        assert(found == (long) w->ops);                                      \
+        sink += v;                                                           \
+                                                                             \
+        t0 = now();                                                          \
+        for (size_t i = 0; i < w->ops; i++)                                  \
+            found += get(m, w->misses[i], &v);                               \
+        r->miss = (now() - t0) * 1e9 / w->ops;                               \
+        assert(found == (long) w->ops);                                      \
+                                                                             \
+        r->mixed = -1;                                                       \
+        if (UPDATE) {                                                        \
+            t0 = now();                                                      \
+            for (size_t i = 0; i < w->ops; i++) {                            \
+                if (i % 5 == 0)                                              \
+                    name##_update(m, w->hits[i], (int) i);                   \
+                else                                                         \
+                    found += get(m, w->hits[i], &v);                         \
+            }                                                                \
+            r->mixed = (now() - t0) * 1e9 / w->ops;                          \
+            sink += v;                                                       \
+        }                                                                    \
+                                                                             \
+        r->churn = -1;                                                       \
+        if (DEL) {                                                           \
+            int *live = malloc(sizeof(int) * w->n);                          \
+            assert(live);                                                    \
+            memcpy(live, w->keys, sizeof(int) * w->n);                       \
+            t0 = now();                                                      \
+            for (size_t i = 0; i < w->ops; i++) {                            \
+                int *victim = &live[w->picks[i] % w->n];                     \
+                name##_del(m, *victim);                                      \
+                *victim = w->fresh[i];                                       \
+                name##_add(m, *victim, (int) i);                             \
+            }                                                                \
+            r->churn = (now() - t0) * 1e9 / w->ops;                          \
+            free(live);                                                      \
+        }                                                                    \
+        sink += found;                                                       \
+        name##_destroy(m);                                                   \
+    }
+
+SUITE_DEFINE(hl, map_t, hl_get, 1, 1)
+SUITE_DEFINE(hlb, map_t, hlb_get, 1, 1)
+SUITE_DEFINE(sw, swiss_map_t, sw_get, 0, 0)
+SUITE_DEFINE(cm, cmap_t, cm_get, 0, 1)
+SUITE_DEFINE(gfib, gfib_t, gfib_getv, 1, 0)
+SUITE_DEFINE(gfmix, gfmix_t, gfmix_getv, 1, 0)
+SUITE_DEFINE(gwy, gwy_t, gwy_getv, 1, 0)
+
+static const struct {
+    const char *name;
+    void (*run)(const struct workload *w, struct result *r);
+} variants[] = {
+    {"map_t", run_hl},           {"map_t+bloom", run_hlb},
+    {"swiss_map_t", run_sw},     {"cmap_t", run_cm},
+    {"gmap fibonacci", run_gfib}, {"gmap fmix64", run_gfmix},
+    {"gmap wyhash", run_gwy},
+};
+
+enum dist { UNIFORM, SEQUENTIAL, STRIDED, ZIPF, NDIST };
+static const char *dist_names[] = {"uniform", "sequential", "strided",
+                                   "zipf"};
+
+/* Strided keys i * 64 are distinct for i below this. */
+#define MAX_KEY_INDEX (1ULL << 26)
+
+/* The i-th key of @d; indices n and up give absent and fresh keys. */
+static inline int key_of(enum dist d, size_t i)
+{
+    switch (d) {
+    case SEQUENTIAL:
+        return (int) i;
+    case STRIDED:
+        return (int) ((uint32_t) i * 64);
+    default:
+        return (int) fmix32((uint32_t) i);
+    }
+}
+
+/*
+ * Zipf ranks by Gray et al.'s method ("Quickly generating billion-record
+ * synthetic databases", SIGMOD 1994), as YCSB uses: O(n) setup for zeta(n),
+ * then O(1) per draw.
+ */
+struct zipf {
+    size_t n;
+    double theta, alpha, zetan, eta;
+};
+
+static void zipf_init(struct zipf *z, size_t n, double theta)
+{
+    double zeta2 = 1 + pow(0.5, theta);
+    z->n = n;
+    z->theta = theta;
+    z->zetan = 0;
+    for (size_t i = 1; i <= n; i++)
+        z->zetan += pow((double) i, -theta);
+    z->alpha = 1 / (1 - theta);
+    z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / z->zetan);
+}
+
+static size_t zipf_next(const struct zipf *z, uint64_t *seed)
+{
+    double u = (xorshift64(seed) >> 11) * 0x1.0p-53;
+    double uz = u * z->zetan;
+    if (uz < 1)
+        return 0;
+    if (uz < 1 + pow(0.5, z->theta))
+        return 1;
+    size_t r = (size_t) (z->n * pow(z->eta * u - z->eta + 1, z->alpha));
+    return r < z->n ? r : z->n - 1;
+}
+
+static void workload_fill(struct workload *w, enum dist d, uint64_t seed)
+{
+    enum dist kd = d == ZIPF ? UNIFORM : d;
+    struct zipf z;
+    if (d == ZIPF)
+        zipf_init(&z, w->n, 0.99);
+
+    for (size_t i = 0; i < w->n; i++)
+        w->keys[i] = key_of(kd, i);
+    /* Sequential keys go in in order; the others in their own order. */
+    for (size_t i = 0; i < w->ops; i++) {
+        size_t h = d == ZIPF ? zipf_next(&z, &seed)
+                             : xorshift64(&seed) % w->n;
+        w->hits[i] = key_of(kd, h);
+        w->misses[i] = key_of(kd, w->n + xorshift64(&seed) % w->n);
+        w->picks[i] = (uint32_t) xorshift64(&seed);
+        w->fresh[i] = key_of(kd, 2 * w->n + i);
+    }
+}
+
+static const char *level_of(double bytes)
+{
+    if (bytes <= sysconf(_SC_LEVEL1_DCACHE_SIZE))
+        return "L1";
+    if (bytes <= sysconf(_SC_LEVEL2_CACHE_SIZE))
+        return "L2";
+    if (bytes <= sysconf(_SC_LEVEL3_CACHE_SIZE))
+        return "LLC";
+    return "DRAM";
+}
+
+static void print_cell(double ns)
+{
+    if (ns < 0)
+        printf(" %8s", "-");
+    else
+        printf(" %8.1f", ns);
+}
+
+int main(int argc, char **argv)
+{
+    long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    double ram = (double) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+    double max_bytes = 10.0 * (llc > 0 ? llc : 32 << 20);
+    if (max_bytes > ram / 4)
+        max_bytes = ram / 4;
+    if (argc > 1)
+        max_bytes = atof(argv[1]) * (1 << 20);
+    size_t ops = argc > 2 ? strtoul(argv[2], NULL, 10) : 1 << 20;
+    if (ops > MAX_KEY_INDEX / 2)
+        ops = MAX_KEY_INDEX / 2;
+
+    /* Key indices run up to 2 * n + ops: present, absent, then fresh. */
+    size_t max_n = (size_t) (max_bytes / 48);
+    if (max_n > (MAX_KEY_INDEX - ops) / 2) {
+        max_n = (MAX_KEY_INDEX - ops) / 2;
+        printf("capped at %zu keys, where strided keys run out\n", max_n);
+    }
+    if (max_n < 1024)
+        max_n = 1024;
+
+    struct workload w = {.ops = ops};
+    w.keys = malloc(sizeof(int) * max_n);
+    w.hits = malloc(sizeof(int) * ops);
+    w.misses = malloc(sizeof(int) * ops);
+    w.picks = malloc(sizeof(uint32_t) * ops);
+    w.fresh = malloc(sizeof(int) * ops);
+    assert(w.keys && w.hits && w.misses && w.picks && w.fresh);
+
+    printf("L1d %ld KiB, L2 %ld KiB, LLC %ld MiB; up to %zu keys, %zu ops "
+           "per timing\n",
+           sysconf(_SC_LEVEL1_DCACHE_SIZE) >> 10,
+           sysconf(_SC_LEVEL2_CACHE_SIZE) >> 10, llc >> 20, max_n, ops);
+    for (int d = 0; d < NDIST; d++) {
+        for (size_t n = 1024, last = 0; !last; n *= 4) {
+            if (n >= max_n) {
+                n = max_n; /* the target itself, not the 4x step below it */
+                last = 1;
+            }
+            w.n = n;
+            workload_fill(&w, d, 0x9E3779B97F4A7C15ULL ^ n);
+            printf("\n%s, %zu keys (~%s)\n%-16s %8s %8s %8s %8s %8s %8s\n",
+                   dist_names[d], n, level_of(48.0 * n), "ns/op", "insert",
+                   "hit", "miss", "mixed", "churn", "B/entry");
+            for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]);
+                 v++) {
+                struct result r;
+                variants[v].run(&w, &r);
+                printf("%-16s", variants[v].name);
+                print_cell(r.insert);
+                print_cell(r.hit);
+                print_cell(r.miss);
+                print_cell(r.mixed);
+                print_cell(r.churn);
+                printf(" %8.1f\n", r.bytes);
+                fflush(stdout);
+            }
+        }
+    }
+
+    free(w.keys);
+    free(w.hits);
+    free(w.misses);
+    free(w.picks);
+    free(w.fresh);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/* Compare the hlist map_t with swiss_map_t on hit- and miss-heavy lookups
+ *
+ * Build: gcc -O2 -msse2 -o swiss_bench swiss_bench.c
+ * Usage: ./swiss_bench [keys]
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "map.h"
+#include "swiss_map.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Distinct keys; odd multiples are hits, even ones misses. */
+static inline int key_of(size_t i)
+{
+    return (int) ((2 * i + 1) * 2654435761u);
+}
+
+static void shuffle(int *a, size_t n)
+{
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = ((size_t) rand() << 16 ^ rand()) % (i + 1);
+        int t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+    }
+}
+
+static int *boxed(int v)
+{
+    int *p = malloc(sizeof(int));
+    *p = v;
+    return p;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 22;
+    int *hits = malloc(sizeof(int) * n), *misses = malloc(sizeof(int) * n);
+    assert(hits && misses);
+    for (size_t i = 0; i < n; i++) {
+        hits[i] = key_of(i);
+        misses[i] = (int) (2 * i * 2654435761u);
+    }
+    shuffle(hits, n);
+    shuffle(misses, n);
+
+    map_t *map = map_init(10);
+    swiss_map_t *swiss = swiss_map_init(10);
+
+    double t0 = now();
+    for (size_t i = 0; i < n; i++)
+        map_add(map, key_of(i), boxed(i));
+    double t_map_add = now() - t0;
+
+    t0 = now();
+    for (size_t i = 0; i < n; i++)
+        swiss_map_add(swiss, key_of(i), boxed(i));
+    double t_swiss_add = now() - t0;
+
+    long found = 0;
+    t0 = now();
+    for (size_t i = 0; i < n; i++)
+        found += map_get(map, hits[i]) != NULL;
+    double t_map_hit = now() - t0;
+    for (size_t i = 0; i < n; i++)
+        found += map_get(map, misses[i]) != NULL;
+    double t_map_miss = now() - t0 - t_map_hit;
+    assert(found == (long) n);
+
+    found = 0;
+    t0 = now();
+    for (size_t i = 0; i < n; i++)
+        found += swiss_map_get(swiss, hits[i]) != NULL;
+    double t_swiss_hit = now() - t0;
+    for (size_t i = 0; i < n; i++)
+        found += swiss_map_get(swiss, misses[i]) != NULL;
+    double t_swiss_miss = now() - t0 - t_swiss_hit;
+    assert(found == (long) n);
+
+    double ns = 1e9 / n;
+    printf("n = %zu keys\n", n);
+    printf("%-12s %10s %10s %10s\n", "ns/op", "insert", "hit", "miss");
+    printf("%-12s %10.1f %10.1f %10.1f\n", "hlist map", t_map_add * ns,
+           t_map_hit * ns, t_map_miss * ns);
+    printf("%-12s %10.1f %10.1f %10.1f\n", "swiss map", t_swiss_add * ns,
+           t_swiss_hit * ns, t_swiss_miss * ns);
+
+    map_deinit(map);
+    swiss_map_deinit(swiss);
+    free(hits);
+    free(misses);
+    return 0;
+}
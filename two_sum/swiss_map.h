@@ -0,0 +1,202 @@
+/* Open-addressing hash map with SIMD-probed control bytes (Swiss table) */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * swiss_map_t - drop-in alternative to map_t with the same API shape
+ *
+ * Slots live in one flat array, split into groups of 16. Every slot has a
+ * control byte: SWISS_EMPTY, or the top 7 bits of the key's hash (h2) when
+ * occupied. A lookup hashes once, picks a starting group from the low hash
+ * bits (h1) and compares all 16 control bytes of the group against h2 with
+ * one SSE2 compare and movemask. Only slots whose control byte matches are
+ * checked against the key, and an empty byte in the group ends the search,
+ * so most hits and misses touch one control line and one slot line.
+ *
+ * Groups are probed triangularly (g, g+1, g+3, g+6, ...), which visits every
+ * group when the group count is a power of two. The table doubles at 7/8
+ * occupancy. As with map_t, swiss_map_deinit() frees every stored data
+ * pointer.
+ */
+
+#define SWISS_GROUP 16
+#define SWISS_EMPTY ((int8_t) -128)
+
+struct swiss_slot {
+    int key;
+    void *data;
+};
+
+typedef struct {
+    int bits;      /* 2^bits slots */
+    size_t count;
+    int8_t *ctrl;  /* one control byte per slot */
+    struct swiss_slot *slots;
+} swiss_map_t;
+
+static inline uint64_t swiss_hash(int key)
+{
+    /* Multiply, then fold the high bits down so the low bits used to pick
+     * a group depend on every key bit.
+     */
+    uint64_t h = (uint64_t) (uint32_t) key * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    return h ^ (h >> 32);
+}
+
+/* Bitmask of the slots in the group at @ctrl whose byte equals @b. */
+static inline unsigned swiss_match(const int8_t *ctrl, int8_t b)
+{
+#ifdef __SSE2__
+    __m128i group = _mm_load_si128((const __m128i *) ctrl);
+    return (unsigned) _mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8(b)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < SWISS_GROUP; i++)
+        mask |= (unsigned) (ctrl[i] == b) << i;
+    return mask;
+#endif
+}
+
+static inline bool swiss_alloc(swiss_map_t *map, int bits)
+{
+    size_t n = (size_t) 1 << bits;
+    int8_t *ctrl = aligned_alloc(SWISS_GROUP, n);
+    struct swiss_slot *slots = malloc(sizeof(struct swiss_slot) * n);
+    if (!ctrl || !slots) {
+        free(ctrl);
+        free(slots);
+        return false;
+    }
+    memset(ctrl, SWISS_EMPTY, n);
+    map->bits = bits;
+    map->ctrl = ctrl;
+    map->slots = slots;
+    return true;
+}
+
+static inline swiss_map_t *swiss_map_init(int bits)
+{
+    swiss_map_t *map = malloc(sizeof(swiss_map_t));
+    if (!map)
+        return NULL;
+
+    if (bits < 4)
+        bits = 4; /* at least one full group */
+    map->count = 0;
+    if (!swiss_alloc(map, bits)) {
+        free(map);
+        return NULL;
+    }
+    return map;
+}
+
+/* Slot index holding @key, or -1. */
+static inline long swiss_find(const swiss_map_t *map, int key, uint64_t h)
+{
+    int group_bits = map->bits - 4;
+    size_t ngroups_mask = ((size_t) 1 << group_bits) - 1;
+    size_t g = (size_t) h & ngroups_mask;
+    int8_t h2 = (int8_t) (h >> 57);
+
+    for (size_t step = 0; step <= ngroups_mask; step++) {
+        const int8_t *ctrl = &map->ctrl[g * SWISS_GROUP];
+        unsigned mask = swiss_match(ctrl, h2);
+        while (mask) {
+            size_t slot = g * SWISS_GROUP + __builtin_ctz(mask);
+            if (map->slots[slot].key == key)
+                return (long) slot;
+            mask &= mask - 1;
+        }
+        if (swiss_match(ctrl, SWISS_EMPTY))
+            return -1;
+        g = (g + step + 1) & ngroups_mask;
+    }
+    return -1;
+}
+
+/* Place a key known to be absent; the table must have a free slot. */
+static inline void swiss_insert_new(swiss_map_t *map,
+                                    int key,
+                                    void *data,
+                                    uint64_t h)
+{
+    int group_bits = map->bits - 4;
+    size_t ngroups_mask = ((size_t) 1 << group_bits) - 1;
+    size_t g = (size_t) h & ngroups_mask;
+
+    for (size_t step = 0;; step++) {
+        unsigned empty = swiss_match(&map->ctrl[g * SWISS_GROUP], SWISS_EMPTY);
+        if (empty) {
+            size_t slot = g * SWISS_GROUP + __builtin_ctz(empty);
+            map->ctrl[slot] = (int8_t) (h >> 57);
+            map->slots[slot].key = key;
+            map->slots[slot].data = data;
+            map->count++;
+            return;
+        }
+        g = (g + step + 1) & ngroups_mask;
+    }
+}
+
+static inline bool swiss_grow(swiss_map_t *map)
+{
+    swiss_map_t old = *map;
+    if (!swiss_alloc(map, old.bits + 1)) {
+        *map = old;
+        return false;
+    }
+
+    map->count = 0;
+    for (size_t i = 0; i < (size_t) 1 << old.bits; i++) {
+        if (old.ctrl[i] != SWISS_EMPTY)
+            swiss_insert_new(map, old.slots[i].key, old.slots[i].data,
+                             swiss_hash(old.slots[i].key));
+    }
+    free(old.ctrl);
+    free(old.slots);
+    return true;
+}
+
+static inline void *swiss_map_get(swiss_map_t *map, int key)
+{
+    long slot = swiss_find(map, key, swiss_hash(key));
+    return slot < 0 ? NULL : map->slots[slot].data;
+}
+
+static inline void swiss_map_add(swiss_map_t *map, int key, void *data)
+{
+    uint64_t h = swiss_hash(key);
+    if (swiss_find(map, key, h) >= 0)
+        return;
+
+    size_t cap = (size_t) 1 << map->bits;
+    if (map->count + 1 > cap - cap / 8 && !swiss_grow(map))
+        return;
+    swiss_insert_new(map, key, data, h);
+}
+
+static inline void swiss_map_deinit(swiss_map_t *map)
+{
+    if (!map)
+        return;
+
+    for (size_t i = 0; i < (size_t) 1 << map->bits; i++) {
+        if (map->ctrl[i] != SWISS_EMPTY)
+            free(map->slots[i].data);
+    }
+    free(map->ctrl);
+    free(map->slots);
+    free(map);
+}
@@ -0,0 +1,341 @@
+/* Work-stealing fork/join thread pool built on Chase-Lev deques */
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Usage:
+ *
+ *   struct tpool *pool = tpool_create(0);          // 0: one per online CPU
+ *   tpool_run(pool, root_fn, root_arg);            // caller joins as worker 0
+ *   tpool_print_stats(pool, "sort");
+ *   tpool_destroy(pool);
+ *
+ * Inside a task, fork/join is expressed with a caller-owned task_t:
+ *
+ *   task_t t;
+ *   tpool_spawn(&t, left_fn, left_arg);   // may be stolen by another worker
+ *   right_fn(right_arg);                  // keep working on the other half
+ *   tpool_sync(&t);                       // help out until @t has finished
+ *
+ * Every worker owns a fixed-size Chase-Lev deque. The owner pushes and pops
+ * at the bottom, thieves steal from the top, so a worker runs its own tasks
+ * in LIFO order (cache-warm, depth-first) while thieves grab the oldest and
+ * usually largest subproblems. A spawn that finds its deque full, or that is
+ * issued outside tpool_run(), simply runs the task inline.
+ *
+ * Only one tpool_run() may be active on a pool at a time.
+ */
+
+#ifndef TPOOL_DEQUE_SIZE
+#define TPOOL_DEQUE_SIZE 4096 /* must be a power of two */
+#endif
+
+typedef struct task {
+    void (*fn)(void *arg);
+    void *arg;
+    atomic_bool done;
+} task_t;
+
+struct tpool_deque {
+    atomic_long top, bottom;
+    _Atomic(task_t *) buf[TPOOL_DEQUE_SIZE];
+};
+
+struct tpool_stats {
+    unsigned long tasks;  /* tasks executed, including inline fallbacks */
+    unsigned long steals; /* tasks successfully stolen from another deque */
+    unsigned long idle;   /* steal rounds that found nothing to do */
+};
+
+/* Per-worker counters: written only by their owner, read by anyone. */
+struct tpool_counters {
+    atomic_ulong tasks, steals, idle;
+};
+
+static inline void tpool_count(atomic_ulong *c)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+struct tpool;
+
+struct tpool_worker {
+    struct tpool *pool;
+    int id;
+    unsigned seed;
+    pthread_t thread;
+    struct tpool_deque deque;
+    struct tpool_counters stats;
+} __attribute__((aligned(64)));
+
+struct tpool {
+    int nthreads;
+    struct tpool_worker *workers;
+    atomic_bool active, shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+static __thread struct tpool_worker *tpool_self;
+
+static inline bool tpool_deque_push(struct tpool_deque *q, task_t *t)
+{
+    long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&q->top, memory_order_acquire);
+    if (b - top > TPOOL_DEQUE_SIZE - 1)
+        return false;
+    atomic_store_explicit(&q->buf[b & (TPOOL_DEQUE_SIZE - 1)], t,
+                          memory_order_relaxed);
+    /* Publish the task to thieves that load bottom with acquire. */
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_release);
+    return true;
+}
+
+static inline task_t *tpool_deque_pop(struct tpool_deque *q)
+{
+    long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+
+    task_t *x = NULL;
+    if (t <= b) {
+        x = atomic_load_explicit(&q->buf[b & (TPOOL_DEQUE_SIZE - 1)],
+                                 memory_order_relaxed);
+        if (t == b) {
+            /* Last element: race against thieves for it. */
+            if (!atomic_compare_exchange_strong_explicit(
+                    &q->top, &t, t + 1, memory_order_seq_cst,
+                    memory_order_relaxed))
+                x = NULL;
+            atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    }
+    return x;
+}
+
+static inline task_t *tpool_deque_steal(struct tpool_deque *q)
+{
+    long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+    if (t >= b)
+        return NULL;
+
+    task_t *x = atomic_load_explicit(&q->buf[t & (TPOOL_DEQUE_SIZE - 1)],
+                                     memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(
+            &q->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return x;
+}
+
+static inline void tpool_execute(struct tpool_worker *w, task_t *t)
+{
+    t->fn(t->arg);
+    atomic_store_explicit(&t->done, true, memory_order_release);
+    if (w)
+        tpool_count(&w->stats.tasks);
+}
+
+/* Try every other worker once, starting at a random victim. */
+static inline task_t *tpool_try_steal(struct tpool_worker *w)
+{
+    struct tpool *pool = w->pool;
+    if (pool->nthreads < 2)
+        return NULL;
+
+    int start = rand_r(&w->seed) % pool->nthreads;
+    for (int i = 0; i < pool->nthreads; i++) {
+        int victim = (start + i) % pool->nthreads;
+        if (victim == w->id)
+            continue;
+        task_t *t = tpool_deque_steal(&pool->workers[victim].deque);
+        if (t) {
+            tpool_count(&w->stats.steals);
+            return t;
+        }
+    }
+    tpool_count(&w->stats.idle);
+    return NULL;
+}
+
+static void *tpool_worker_main(void *arg)
+{
+    struct tpool_worker *w = arg;
+    struct tpool *pool = w->pool;
+    tpool_self = w;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!atomic_load(&pool->active) && !atomic_load(&pool->shutdown))
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+        if (atomic_load(&pool->shutdown))
+            break;
+
+        while (atomic_load_explicit(&pool->active, memory_order_acquire)) {
+            task_t *t = tpool_deque_pop(&w->deque);
+            if (!t)
+                t = tpool_try_steal(w);
+            if (t)
+                tpool_execute(w, t);
+            else
+                sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static inline void tpool_reset_stats(struct tpool *pool)
+{
+    for (int i = 0; i < pool->nthreads; i++) {
+        struct tpool_counters *c = &pool->workers[i].stats;
+        atomic_store_explicit(&c->tasks, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->steals, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->idle, 0, memory_order_relaxed);
+    }
+}
+
+/* Create a pool of @nthreads workers (including the tpool_run() caller).
+ * If the system refuses some of the threads, the pool runs with the workers
+ * it got, down to just the caller; pool->nthreads says how many.
+ */
+static inline struct tpool *tpool_create(int nthreads)
+{
+    if (nthreads <= 0)
+        nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0)
+        nthreads = 1;
+
+    struct tpool *pool = malloc(sizeof(struct tpool));
+    if (!pool)
+        return NULL;
+    if (posix_memalign((void **) &pool->workers, 64,
+                       sizeof(struct tpool_worker) * nthreads)) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->nthreads = nthreads;
+    atomic_init(&pool->active, false);
+    atomic_init(&pool->shutdown, false);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (int i = 0; i < nthreads; i++) {
+        struct tpool_worker *w = &pool->workers[i];
+        w->pool = pool;
+        w->id = i;
+        w->seed = 0x9E3779B9u * (i + 1);
+        atomic_init(&w->deque.top, 0);
+        atomic_init(&w->deque.bottom, 0);
+    }
+    tpool_reset_stats(pool);
+    /* Worker 0 is whichever thread calls tpool_run(). */
+    for (int i = 1; i < nthreads; i++) {
+        int err = pthread_create(&pool->workers[i].thread, NULL,
+                                 tpool_worker_main, &pool->workers[i]);
+        if (err) {
+            fprintf(stderr, "tpool: only %d of %d workers: %s\n", i,
+                    nthreads, strerror(err));
+            pool->nthreads = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+static inline void tpool_destroy(struct tpool *pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->shutdown, true);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->nthreads; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->workers);
+    free(pool);
+}
+
+static inline void tpool_spawn(task_t *t, void (*fn)(void *), void *arg)
+{
+    t->fn = fn;
+    t->arg = arg;
+    atomic_init(&t->done, false);
+
+    struct tpool_worker *w = tpool_self;
+    if (!w || !atomic_load_explicit(&w->pool->active, memory_order_relaxed) ||
+        !tpool_deque_push(&w->deque, t))
+        tpool_execute(w, t);
+}
+
+/* Wait for @t, running local or stolen tasks in the meantime. */
+static inline void tpool_sync(task_t *t)
+{
+    struct tpool_worker *w = tpool_self;
+    while (!atomic_load_explicit(&t->done, memory_order_acquire)) {
+        task_t *other = tpool_deque_pop(&w->deque);
+        if (!other)
+            other = tpool_try_steal(w);
+        if (other)
+            tpool_execute(w, other);
+        else
+            sched_yield();
+    }
+}
+
+/* Run @fn(@arg) on the calling thread with the pool's workers helping. */
+static inline void tpool_run(struct tpool *pool, void (*fn)(void *), void *arg)
+{
+    struct tpool_worker *prev = tpool_self;
+    tpool_self = &pool->workers[0];
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->active, true);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    fn(arg);
+
+    atomic_store_explicit(&pool->active, false, memory_order_release);
+    tpool_self = prev;
+}
+
+static inline struct tpool_stats tpool_get_stats(const struct tpool *pool)
+{
+    struct tpool_stats sum = {0, 0, 0};
+    for (int i = 0; i < pool->nthreads; i++) {
+        const struct tpool_counters *c = &pool->workers[i].stats;
+        sum.tasks += atomic_load_explicit(&c->tasks, memory_order_relaxed);
+        sum.steals += atomic_load_explicit(&c->steals, memory_order_relaxed);
+        sum.idle += atomic_load_explicit(&c->idle, memory_order_relaxed);
+    }
+    return sum;
+}
+
+static inline void tpool_print_stats(const struct tpool *pool,
+                                     const char *name)
+{
+    struct tpool_stats s = tpool_get_stats(pool);
+    fprintf(stderr, "[tpool] %s: threads=%d tasks=%lu steals=%lu idle=%lu\n",
+            name, pool->nthreads, s.tasks, s.steals, s.idle);
+}
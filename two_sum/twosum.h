@@ -0,0 +1,525 @@
+/* Batched twoSum queries against one prebuilt index of nums */
+
+#pragma once
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "map.h"
+#include "tpool.h"
+
+/**
+ * Usage:
+ *
+ *   twosum_index_t *ix = twosum_build(nums, n, TWOSUM_AUTO);
+ *   struct twosum_answer *ans = calloc(m, sizeof(*ans));
+ *   twosum_query(ix, targets, m, TWOSUM_FIRST, ans, pool);  // pool may be NULL
+ *   ... ans[k].i, ans[k].j, or ans[k].pairs in TWOSUM_ALL mode ...
+ *   twosum_answers_free(ans, m);
+ *   twosum_free(ix);
+ *
+ * A pair is two indices i < j with nums[i] + nums[j] == target, computed
+ * without overflow. The first pair of a target is the one with the smallest
+ * j, then the smallest i, which is what a single left-to-right twoSum() pass
+ * finds. TWOSUM_ALL lists every pair ordered the same way. Both strategies
+ * return identical answers.
+ *
+ * Building radix-sorts the (value, index) pairs once, so equal values form
+ * runs of ascending indices. The hash strategy adds a map_t from each value
+ * to its run, with a Bloom filter in front since most complements miss, and
+ * answers a target by looking up target - nums[j] for j = 0, 1, ... through
+ * map_get_batch(); first-pair queries stop at the first hit. The sorted
+ * strategy walks the sorted values with two pointers instead, which streams
+ * memory sequentially and needs no table, but always scans the whole array.
+ *
+ * A sorted scan costs a few ns per element against 5-15 ns per hash lookup,
+ * so the hash strategy only wins when a first pair turns up early. With
+ * TWOSUM_AUTO the index keeps both (the table only while it stays under
+ * TWOSUM_HASH_MAX_BYTES): TWOSUM_ALL queries always scan the sorted array,
+ * and TWOSUM_FIRST queries look up the first n / TWOSUM_PROBE_DIV
+ * complements by hash before falling back to the sorted scan. A target
+ * whose first pair is late pays for both, up to about twice the scan alone
+ * on tables that spill the caches, while one with an early pair is answered
+ * in a handful of lookups.
+ */
+
+/* Targets per task; large arrays give every target its own task. */
+#ifndef TWOSUM_GRAIN_OPS
+#define TWOSUM_GRAIN_OPS 65536
+#endif
+
+/* Complements looked up per map_get_batch() call. */
+#ifndef TWOSUM_CHUNK
+#define TWOSUM_CHUNK 256
+#endif
+
+/* TWOSUM_AUTO skips the table (about 80 bytes per value) above this. */
+#ifndef TWOSUM_HASH_MAX_BYTES
+#define TWOSUM_HASH_MAX_BYTES (512UL << 20)
+#endif
+
+/* Share of a TWOSUM_AUTO first-pair query answered by hash lookups. */
+#ifndef TWOSUM_PROBE_DIV
+#define TWOSUM_PROBE_DIV 4
+#endif
+
+enum twosum_strategy { TWOSUM_AUTO, TWOSUM_HASH, TWOSUM_SORTED };
+enum twosum_mode { TWOSUM_FIRST, TWOSUM_ALL };
+
+struct twosum_answer {
+    int i, j;        /* first pair, i < j; both -1 when there is none */
+    size_t count;    /* number of pairs; at most 1 for TWOSUM_FIRST */
+    int (*pairs)[2]; /* TWOSUM_ALL: every {i, j}, by j then i; malloc()ed */
+    size_t cap;
+};
+
+/* Indices [start, start + len) of sorted_idx all hold the same value. */
+struct twosum_run {
+    uint32_t start, len;
+};
+
+typedef struct {
+    int n;
+    enum twosum_strategy strategy; /* TWOSUM_AUTO: both, see above */
+    int *nums;                     /* copy of the input */
+    int *sorted;                   /* nums in ascending order */
+    uint32_t *sorted_idx;          /* their indices, ascending within a run */
+    map_t *map;                    /* value -> struct twosum_run (hash) */
+} twosum_index_t;
+
+/* Stable LSD radix sort of @n values by their int key in the top half. */
+static inline bool twosum_radix_sort(uint64_t *a, size_t n)
+{
+    uint64_t *orig = a, *tmp = malloc(sizeof(uint64_t) * n);
+    if (!tmp)
+        return false;
+
+    for (int shift = 32; shift < 64; shift += 8) {
+        size_t count[256] = {0};
+        for (size_t i = 0; i < n; i++)
+            count[(a[i] >> shift) & 0xff]++;
+        if (count[(a[0] >> shift) & 0xff] == n)
+            continue; /* every key shares this byte */
+        size_t sum = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = count[b];
+            count[b] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++)
+            tmp[count[(a[i] >> shift) & 0xff]++] = a[i];
+        uint64_t *t = a;
+        a = tmp;
+        tmp = t;
+    }
+    /* An odd number of passes leaves the result in the scratch buffer. */
+    if (a != orig) {
+        memcpy(orig, a, sizeof(uint64_t) * n);
+        tmp = a;
+    }
+    free(tmp);
+    return true;
+}
+
+static inline void twosum_free(twosum_index_t *ix)
+{
+    if (!ix)
+        return;
+    map_deinit(ix->map);
+    free(ix->nums);
+    free(ix->sorted);
+    free(ix->sorted_idx);
+    free(ix);
+}
+
+static inline bool twosum_build_map(twosum_index_t *ix)
+{
+    size_t runs = 0;
+    for (int k = 0; k < ix->n; k++)
+        runs += k == 0 || ix->sorted[k] != ix->sorted[k - 1];
+
+    ix->map = map_init(10);
+    if (!ix->map || !map_reserve(ix->map, runs) ||
+        !map_bloom_enable(ix->map, runs))
+        return false;
+    for (int k = 0; k < ix->n;) {
+        struct twosum_run r = {(uint32_t) k, 1};
+        while (k + r.len < (uint32_t) ix->n &&
+               ix->sorted[k + r.len] == ix->sorted[k])
+            r.len++;
+        map_add_value(ix->map, ix->sorted[k], &r, sizeof(r));
+        k += r.len;
+    }
+    map_rehash_finish(ix->map);
+    return ix->map->count == runs;
+}
+
+/**
+ * twosum_build() - index @nums for twosum_query()
+ * @strategy: TWOSUM_AUTO builds the table unless it would be too large
+ *
+ * The array is copied; later changes to @nums are not seen. NULL when out of
+ * memory.
+ */
+static inline twosum_index_t *twosum_build(const int *nums,
+                                           int n,
+                                           enum twosum_strategy strategy)
+{
+    twosum_index_t *ix = calloc(1, sizeof(twosum_index_t));
+    if (!ix || n < 0)
+        goto fail;
+    ix->n = n;
+    if (strategy == TWOSUM_AUTO && (size_t) n * 80 > TWOSUM_HASH_MAX_BYTES)
+        strategy = TWOSUM_SORTED;
+    ix->strategy = strategy;
+
+    size_t sz = n ? n : 1;
+    uint64_t *packed = malloc(sizeof(uint64_t) * sz);
+    ix->nums = malloc(sizeof(int) * sz);
+    ix->sorted = malloc(sizeof(int) * sz);
+    ix->sorted_idx = malloc(sizeof(uint32_t) * sz);
+    if (!packed || !ix->nums || !ix->sorted || !ix->sorted_idx) {
+        free(packed);
+        goto fail;
+    }
+    memcpy(ix->nums, nums, sizeof(int) * n);
+
+    /* Flipping the sign bit makes unsigned order match int order. */
+    for (int k = 0; k < n; k++)
+        packed[k] = (uint64_t) ((uint32_t) nums[k] ^ 0x80000000u) << 32 | k;
+    if (n && !twosum_radix_sort(packed, n)) {
+        free(packed);
+        goto fail;
+    }
+    for (int k = 0; k < n; k++) {
+        ix->sorted[k] = (int) ((uint32_t) (packed[k] >> 32) ^ 0x80000000u);
+        ix->sorted_idx[k] = (uint32_t) packed[k];
+    }
+    free(packed);
+
+    if (strategy != TWOSUM_SORTED && !twosum_build_map(ix))
+        goto fail;
+    return ix;
+
+fail:
+    twosum_free(ix);
+    return NULL;
+}
+
+static inline bool twosum_push(struct twosum_answer *a, int i, int j)
+{
+    if (a->count == 0)
+        a->i = i, a->j = j;
+    if (a->count == a->cap) {
+        size_t cap = a->cap ? a->cap * 2 : 4;
+        int(*p)[2] = realloc(a->pairs, sizeof(int[2]) * cap);
+        if (!p)
+            return false;
+        a->pairs = p;
+        a->cap = cap;
+    }
+    a->pairs[a->count][0] = i;
+    a->pairs[a->count][1] = j;
+    a->count++;
+    return true;
+}
+
+/* Hash strategy: complements of nums[0..@limit) in batches, in order. */
+static inline bool twosum_hash_one(const twosum_index_t *ix,
+                                   map_t *map,
+                                   long target,
+                                   enum twosum_mode mode,
+                                   int limit,
+                                   struct twosum_answer *a)
+{
+    int keys[TWOSUM_CHUNK];
+    void *out[TWOSUM_CHUNK];
+
+    for (int base = 0; base < limit; base += TWOSUM_CHUNK) {
+        int m = limit - base < TWOSUM_CHUNK ? limit - base : TWOSUM_CHUNK;
+        for (int k = 0; k < m; k++) {
+            long want = target - ix->nums[base + k];
+            /* Out-of-range complements cannot match; look up nums[j]. */
+            keys[k] = want < INT_MIN || want > INT_MAX ? ix->nums[base + k]
+                                                       : (int) want;
+        }
+        map_get_batch(map, keys, out, m);
+
+        for (int k = 0; k < m; k++) {
+            int j = base + k;
+            const struct twosum_run *r = out[k];
+            if (!r || (long) keys[k] + ix->nums[j] != target)
+                continue;
+            for (uint32_t s = r->start; s < r->start + r->len; s++) {
+                int i = (int) ix->sorted_idx[s];
+                if (i >= j)
+                    break;
+                if (mode == TWOSUM_FIRST) {
+                    a->i = i, a->j = j;
+                    a->count = 1;
+                    return true;
+                }
+                if (!twosum_push(a, i, j))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * twosum_skip_below() - first k in [@lo, @hi] with v[k] >= @lim, or @hi
+ *
+ * The values are sorted, so within a block the lanes below @lim form a
+ * prefix and their count is how far to advance. Eight lanes are compared per
+ * step, which pays off on the long one-sided runs of skewed inputs.
+ */
+static inline int twosum_skip_below(const int *v, int lo, int hi, long lim)
+{
+    if (lim > INT_MAX)
+        return hi;
+#ifdef __AVX2__
+    __m256i l = _mm256_set1_epi32((int) lim);
+    while (lo + 8 <= hi) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (v + lo));
+        int below = _mm256_movemask_ps(_mm256_castsi256_ps(
+            _mm256_cmpgt_epi32(l, x)));
+        lo += __builtin_popcount(below);
+        if (below != 0xff)
+            return lo;
+    }
+#endif
+    while (lo < hi && v[lo] < lim)
+        lo++;
+    return lo;
+}
+
+/* Mirror image: last k in [@lo, @hi] with v[k] <= @lim, or @lo. */
+static inline int twosum_skip_above(const int *v, int lo, int hi, long lim)
+{
+    if (lim < INT_MIN)
+        return lo;
+#ifdef __AVX2__
+    __m256i l = _mm256_set1_epi32((int) lim);
+    while (hi - 8 >= lo) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (v + hi - 7));
+        int above = _mm256_movemask_ps(_mm256_castsi256_ps(
+            _mm256_cmpgt_epi32(x, l)));
+        hi -= __builtin_popcount(above);
+        if (above != 0xff)
+            return hi;
+    }
+#endif
+    while (hi > lo && v[hi] > lim)
+        hi--;
+    return hi;
+}
+
+static int twosum_cmp_pair(const void *lhs, const void *rhs)
+{
+    const int *a = lhs, *b = rhs;
+    if (a[1] != b[1])
+        return a[1] < b[1] ? -1 : 1;
+    return a[0] < b[0] ? -1 : a[0] > b[0];
+}
+
+/* Record the pair of @x and @y, or in TWOSUM_FIRST keep the earlier one. */
+static inline bool twosum_emit(struct twosum_answer *a,
+                               enum twosum_mode mode,
+                               int x,
+                               int y)
+{
+    int i = x < y ? x : y, j = x < y ? y : x;
+    if (mode == TWOSUM_ALL)
+        return twosum_push(a, i, j);
+    if (!a->count || j < a->j || (j == a->j && i < a->i)) {
+        a->i = i, a->j = j;
+        a->count = 1;
+    }
+    return true;
+}
+
+/* Sorted strategy: two pointers closing in over the sorted values. */
+static inline bool twosum_sorted_one(const twosum_index_t *ix,
+                                     long target,
+                                     enum twosum_mode mode,
+                                     struct twosum_answer *a)
+{
+    const int *v = ix->sorted;
+    const uint32_t *idx = ix->sorted_idx;
+    int lo = 0, hi = ix->n - 1;
+
+    while (lo < hi) {
+        long sum = (long) v[lo] + v[hi];
+        if (sum < target) {
+            lo = twosum_skip_below(v, lo, hi, target - v[hi]);
+            continue;
+        }
+        if (sum > target) {
+            hi = twosum_skip_above(v, lo, hi, target - v[lo]);
+            continue;
+        }
+
+        if (v[lo] == v[hi]) {
+            /* One run of equal values: every two of its indices pair up. */
+            if (mode == TWOSUM_FIRST)
+                return twosum_emit(a, mode, idx[lo], idx[lo + 1]);
+            for (int y = lo + 1; y <= hi; y++)
+                for (int x = lo; x < y; x++)
+                    if (!twosum_emit(a, mode, idx[x], idx[y]))
+                        return false;
+            break;
+        }
+        int lo_end = lo, hi_start = hi;
+        while (v[lo_end + 1] == v[lo])
+            lo_end++;
+        while (v[hi_start - 1] == v[hi])
+            hi_start--;
+        if (mode == TWOSUM_FIRST) {
+            /* Each run's smallest index comes first. */
+            twosum_emit(a, mode, idx[lo], idx[hi_start]);
+        } else {
+            for (int x = lo; x <= lo_end; x++)
+                for (int y = hi_start; y <= hi; y++)
+                    if (!twosum_emit(a, mode, idx[x], idx[y]))
+                        return false;
+        }
+        lo = lo_end + 1;
+        hi = hi_start - 1;
+    }
+
+    if (mode == TWOSUM_ALL && a->count > 1)
+        qsort(a->pairs, a->count, sizeof(int[2]), twosum_cmp_pair);
+    if (a->count) {
+        a->i = a->pairs ? a->pairs[0][0] : a->i;
+        a->j = a->pairs ? a->pairs[0][1] : a->j;
+    }
+    return true;
+}
+
+static inline bool twosum_one(const twosum_index_t *ix,
+                              map_t *map,
+                              long target,
+                              enum twosum_mode mode,
+                              struct twosum_answer *a)
+{
+    switch (ix->strategy) {
+    case TWOSUM_HASH:
+        return twosum_hash_one(ix, map, target, mode, ix->n, a);
+    case TWOSUM_AUTO:
+        if (mode == TWOSUM_FIRST) {
+            twosum_hash_one(ix, map, target, mode, ix->n / TWOSUM_PROBE_DIV,
+                            a);
+            if (a->count)
+                return true;
+        }
+        /* fall through */
+    default:
+        return twosum_sorted_one(ix, target, mode, a);
+    }
+}
+
+struct twosum_query_ctx {
+    const twosum_index_t *ix;
+    const int *targets;
+    enum twosum_mode mode;
+    struct twosum_answer *out;
+    size_t grain;
+    atomic_bool failed;
+};
+
+struct twosum_job {
+    struct twosum_query_ctx *ctx;
+    size_t lo, hi;
+};
+
+static void twosum_job_run(void *arg)
+{
+    struct twosum_job *job = arg;
+    struct twosum_query_ctx *ctx = job->ctx;
+
+    if (job->hi - job->lo > ctx->grain) {
+        size_t mid = job->lo + (job->hi - job->lo) / 2;
+        struct twosum_job left = {ctx, job->lo, mid};
+        struct twosum_job right = {ctx, mid, job->hi};
+        task_t t;
+        tpool_spawn(&t, twosum_job_run, &left);
+        twosum_job_run(&right);
+        tpool_sync(&t);
+        return;
+    }
+
+    /*
+     * map_get_batch() bumps the Bloom filter counters, so each task looks up
+     * through its own shallow copy of the map and filter header. The table
+     * and filter bits themselves are only read.
+     */
+    map_t map;
+    struct map_bloom bloom;
+    if (ctx->ix->map) {
+        map = *ctx->ix->map;
+        if (map.bloom) {
+            bloom = *map.bloom;
+            map.bloom = &bloom;
+        }
+    }
+
+    for (size_t k = job->lo; k < job->hi; k++) {
+        struct twosum_answer *a = &ctx->out[k];
+        a->i = a->j = -1;
+        a->count = a->cap = 0;
+        a->pairs = NULL;
+        if (!twosum_one(ctx->ix, &map, ctx->targets[k], ctx->mode, a))
+            atomic_store_explicit(&ctx->failed, true, memory_order_relaxed);
+    }
+}
+
+/**
+ * twosum_query() - answer @m targets against @ix
+ * @out:  one answer per target; release with twosum_answers_free()
+ * @pool: worker pool to split the batch across, or NULL for this thread
+ *
+ * The batch is split in halves down to about TWOSUM_GRAIN_OPS element visits
+ * per task, and idle workers steal the halves. Returns false if a TWOSUM_ALL
+ * pair list could not be allocated; that answer is then truncated.
+ */
+static inline bool twosum_query(const twosum_index_t *ix,
+                                const int *targets,
+                                size_t m,
+                                enum twosum_mode mode,
+                                struct twosum_answer *out,
+                                struct tpool *pool)
+{
+    struct twosum_query_ctx ctx = {.ix = ix,
+                                   .targets = targets,
+                                   .mode = mode,
+                                   .out = out};
+    ctx.grain = TWOSUM_GRAIN_OPS / (ix->n ? ix->n : 1);
+    if (!ctx.grain)
+        ctx.grain = 1;
+    atomic_init(&ctx.failed, false);
+
+    struct twosum_job root = {&ctx, 0, m};
+    if (pool)
+        tpool_run(pool, twosum_job_run, &root);
+    else
+        twosum_job_run(&root);
+    return !atomic_load(&ctx.failed);
+}
+
+static inline void twosum_answers_free(struct twosum_answer *out, size_t m)
+{
+    if (!out)
+        return;
+    for (size_t k = 0; k < m; k++)
+        free(out[k].pairs);
+    free(out);
+}
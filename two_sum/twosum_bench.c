@@ -0,0 +1,196 @@
+/* Many twoSum targets against one array: per-call maps vs twosum_query()
+ *
+ * Build: gcc -O2 -mavx2 -pthread -o twosum_bench twosum_bench.c
+ * Usage: ./twosum_bench [max_n] [targets] [threads]
+ *
+ * First every strategy and mode is checked against a brute-force pass on
+ * small arrays with many duplicates and values near INT_MIN/INT_MAX. Then,
+ * for growing arrays, half of the targets are the sum of two random elements
+ * and half are random, and the batch is answered by the old one-map-per-call
+ * twoSum() loop and by each twosum_build() strategy.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "map.h"
+#include "twosum.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline int rand32(void)
+{
+    return (int) ((uint32_t) rand() << 16 ^ (uint32_t) rand());
+}
+
+/* What main.c's twoSum() does, as {i, j} with i < j. */
+static bool twosum_single(const int *nums, int n, int target, int pair[2])
+{
+    map_t *map = map_init(10);
+    bool found = false;
+    for (int j = 0; j < n && !found; j++) {
+        long want = (long) target - nums[j];
+        int *p = want < INT_MIN || want > INT_MAX ? NULL
+                                                  : map_get(map, (int) want);
+        if (p) {
+            pair[0] = *p, pair[1] = j;
+            found = true;
+        } else if (!map_get(map, nums[j])) {
+            map_add_value(map, nums[j], &j, sizeof(j));
+        }
+    }
+    map_deinit(map);
+    return found;
+}
+
+static void check(const int *nums, int n, const int *targets, size_t m)
+{
+    static const enum twosum_strategy strategies[] = {
+        TWOSUM_HASH, TWOSUM_SORTED, TWOSUM_AUTO};
+    for (int s = 0; s < 3; s++) {
+        twosum_index_t *ix = twosum_build(nums, n, strategies[s]);
+        struct twosum_answer *first = calloc(m, sizeof(*first));
+        struct twosum_answer *all = calloc(m, sizeof(*all));
+        assert(ix && first && all);
+        assert(twosum_query(ix, targets, m, TWOSUM_FIRST, first, NULL));
+        assert(twosum_query(ix, targets, m, TWOSUM_ALL, all, NULL));
+
+        for (size_t k = 0; k < m; k++) {
+            size_t c = 0;
+            for (int j = 0; j < n; j++)
+                for (int i = 0; i < j; i++) {
+                    if ((long) nums[i] + nums[j] != targets[k])
+                        continue;
+                    assert(c < all[k].count && all[k].pairs[c][0] == i &&
+                           all[k].pairs[c][1] == j);
+                    if (c++ == 0)
+                        assert(first[k].i == i && first[k].j == j);
+                }
+            assert(all[k].count == c && first[k].count == (c != 0));
+
+            int pair[2];
+            bool found = twosum_single(nums, n, targets[k], pair);
+            assert(found == (c != 0));
+            assert(!found || (pair[0] == first[k].i && pair[1] == first[k].j));
+        }
+        twosum_answers_free(first, m);
+        twosum_answers_free(all, m);
+        twosum_free(ix);
+    }
+}
+
+static void run_checks(void)
+{
+    int nums[300], targets[200];
+    for (int round = 0; round < 20; round++) {
+        int n = rand() % 300;
+        int range = round & 1 ? 50 : 1 << 20;
+        for (int k = 0; k < n; k++) {
+            nums[k] = rand() % range - range / 2;
+            if (round % 4 == 3) /* crowd both ends of the int range */
+                nums[k] += k & 1 ? INT_MAX - range : INT_MIN + range;
+        }
+        for (int k = 0; k < 200; k++)
+            targets[k] = n && k & 1 ? (int) ((long) nums[rand() % n] +
+                                             nums[rand() % n])
+                                    : rand() % range - range / 2;
+        check(nums, n, targets, 200);
+    }
+    printf("checks passed\n");
+}
+
+static double bench(twosum_index_t *ix,
+                    const int *targets,
+                    size_t m,
+                    enum twosum_mode mode,
+                    struct tpool *pool,
+                    size_t *pairs)
+{
+    struct twosum_answer *ans = calloc(m, sizeof(*ans));
+    assert(ans);
+    double t0 = now();
+    assert(twosum_query(ix, targets, m, mode, ans, pool));
+    double t = now() - t0;
+    *pairs = 0;
+    for (size_t k = 0; k < m; k++)
+        *pairs += ans[k].count;
+    twosum_answers_free(ans, m);
+    return t;
+}
+
+int main(int argc, char **argv)
+{
+    int max_n = argc > 1 ? atoi(argv[1]) : 1 << 22;
+    size_t m = argc > 2 ? strtoul(argv[2], NULL, 10) : 64;
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+    srand(1);
+    run_checks();
+
+    struct tpool *pool = tpool_create(threads);
+    int *nums = malloc(sizeof(int) * max_n);
+    int *targets = malloc(sizeof(int) * m);
+    assert(pool && nums && targets);
+
+    printf("%zu targets, %d threads; ms per batch\n", m, pool->nthreads);
+    printf("%9s %5s %12s %10s %10s %10s %8s\n", "n", "mode", "per-call map",
+           "hash", "sorted", "auto", "pairs");
+    static const enum twosum_strategy strategies[] = {
+        TWOSUM_HASH, TWOSUM_SORTED, TWOSUM_AUTO};
+    for (int n = 1 << 12; n <= max_n; n <<= 2) {
+        for (int k = 0; k < n; k++)
+            nums[k] = rand32() >> 2;
+        for (size_t k = 0; k < m; k++)
+            targets[k] = k & 1 ? nums[rand() % n] + nums[rand() % n]
+                               : rand32() >> 1;
+
+        twosum_index_t *ix[3];
+        double t_build[3];
+        for (int s = 0; s < 3; s++) {
+            double t0 = now();
+            ix[s] = twosum_build(nums, n, strategies[s]);
+            t_build[s] = now() - t0;
+            assert(ix[s]);
+        }
+
+        /* The per-call loop is slow; time a few targets and scale up. */
+        size_t few = m < 8 ? m : 8;
+        int pair[2];
+        double t0 = now();
+        for (size_t k = 0; k < few; k++)
+            twosum_single(nums, n, targets[k], pair);
+        double t_single = (now() - t0) * m / few;
+
+        for (int mode = TWOSUM_FIRST; mode <= TWOSUM_ALL; mode++) {
+            size_t pairs[3];
+            double t[3];
+            for (int s = 0; s < 3; s++)
+                t[s] = bench(ix[s], targets, m, mode, pool, &pairs[s]);
+            assert(pairs[0] == pairs[1] && pairs[1] == pairs[2]);
+            char single[24] = "";
+            if (mode == TWOSUM_FIRST)
+                snprintf(single, sizeof(single), "%.1f", t_single * 1e3);
+            printf("%9d %5s %12s %10.1f %10.1f %10.1f %8zu\n", n,
+                   mode == TWOSUM_FIRST ? "first" : "all", single, t[0] * 1e3,
+                   t[1] * 1e3, t[2] * 1e3, pairs[0]);
+        }
+        printf("%9s %5s %12s %10.1f %10.1f %10.1f\n", "", "build", "",
+               t_build[0] * 1e3, t_build[1] * 1e3, t_build[2] * 1e3);
+        for (int s = 0; s < 3; s++)
+            twosum_free(ix[s]);
+    }
+
+    tpool_print_stats(pool, "twosum");
+    tpool_destroy(pool);
+    free(nums);
+    free(targets);
+    return 0;
+}
@@ -0,0 +1,177 @@
+/* twoSum over a sliding window of the last W events of a stream */
+
+#pragma once
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "map.h"
+
+/**
+ * Usage:
+ *
+ *   twosum_stream_t *s = twosum_stream_init(window, target);
+ *   for each event x:
+ *       if (twosum_stream_push(s, x, &partner))
+ *           ... x pairs with event number @partner (0-based) ...
+ *   twosum_stream_free(s);
+ *
+ * Event number n pairs with the newest of events n - W + 1 .. n - 1 whose
+ * value adds up to the target with it, so both ends of a reported pair are
+ * always among the last W events.
+ *
+ * The map holds one node per distinct value in the window, with the number
+ * of copies and the newest event number stored inline. A ring of W node
+ * pointers remembers which node each recent event counted towards, so
+ * evicting the oldest event is a decrement and, for its value's last copy,
+ * map_del_node(): neither needs a lookup. The table is reserved for W
+ * entries up front and deleted nodes are recycled by the next insert, so
+ * memory stays at O(W) however long the stream runs.
+ */
+
+struct twosum_stream_value {
+    uint32_t copies; /* events in the window with this value */
+    uint64_t newest; /* number of the newest of them */
+};
+
+typedef struct {
+    map_t *map;
+    long target;
+    size_t window;
+    struct hash_key **ring; /* node of event n at ring[n % window] */
+    size_t slot;            /* events % window, without the division */
+    uint64_t events;        /* events pushed so far */
+} twosum_stream_t;
+
+/* Events twosum_stream_push_batch() prefetches ahead. */
+#ifndef TWOSUM_STREAM_PREFETCH
+#define TWOSUM_STREAM_PREFETCH 8
+#endif
+
+static inline void twosum_stream_free(twosum_stream_t *s)
+{
+    if (!s)
+        return;
+    map_deinit(s->map);
+    free(s->ring);
+    free(s);
+}
+
+/* Window of the last @window events (at least 1); NULL when out of memory. */
+static inline twosum_stream_t *twosum_stream_init(size_t window, long target)
+{
+    twosum_stream_t *s = calloc(1, sizeof(twosum_stream_t));
+    if (!s || !window)
+        goto fail;
+    s->target = target;
+    s->window = window;
+    s->ring = malloc(sizeof(struct hash_key *) * window);
+    s->map = map_init(10);
+    if (!s->ring || !s->map || !map_reserve(s->map, window))
+        goto fail;
+    return s;
+
+fail:
+    twosum_stream_free(s);
+    return NULL;
+}
+
+/**
+ * twosum_stream_push() - add event @x, evicting the one that left the window
+ * @partner: receives the number of the event @x pairs with, if any
+ *
+ * Returns whether a pair was found. Costs two hash lookups and, for a value
+ * new to the window, one insert. Only the arena can run out of memory, while
+ * the window first fills up; the event is then dropped from the window.
+ */
+static inline bool twosum_stream_push(twosum_stream_t *s,
+                                      int x,
+                                      uint64_t *partner)
+{
+    uint64_t n = s->events++;
+    size_t slot = s->slot;
+    if (++s->slot == s->window)
+        s->slot = 0;
+
+    struct hash_key *old = n >= s->window ? s->ring[slot] : NULL;
+    if (old) {
+        struct twosum_stream_value *v = old->data;
+        if (--v->copies == 0)
+            map_del_node(s->map, old);
+    }
+
+    bool found = false;
+    long want = s->target - x;
+    if (want >= INT_MIN && want <= INT_MAX) {
+        struct twosum_stream_value *v = map_get(s->map, (int) want);
+        if (v) {
+            *partner = v->newest;
+            found = true;
+        }
+    }
+
+    struct hash_key *kn = find_key(s->map, x);
+    if (!kn) {
+        kn = map_insert(s->map, x, sizeof(struct twosum_stream_value));
+        s->ring[slot] = kn;
+        if (!kn) /* out of memory: @x is not remembered */
+            return found;
+        kn->data = kn + 1;
+        *(struct twosum_stream_value *) kn->data =
+            (struct twosum_stream_value){0, 0};
+    }
+    struct twosum_stream_value *v = kn->data;
+    v->copies++;
+    v->newest = n;
+    s->ring[slot] = kn;
+    return found;
+}
+
+/**
+ * twosum_stream_push_batch() - push @m events that have already arrived
+ * @partner: partner[k] receives the event xs[k] pairs with, or UINT64_MAX
+ *
+ * Same answers as pushing one at a time. Knowing the next events lets this
+ * prefetch their buckets, then the first node of each bucket, and the nodes
+ * they will evict, a few events ahead; that matters once the window no
+ * longer fits in cache. Returns the number of pairs found.
+ */
+static inline size_t twosum_stream_push_batch(twosum_stream_t *s,
+                                              const int *xs,
+                                              size_t m,
+                                              uint64_t *partner)
+{
+    map_t *map = s->map;
+    size_t pairs = 0;
+
+    for (size_t k = 0; k < m; k++) {
+        /* Buckets two distances ahead, their first nodes one distance. */
+        if (k + 2 * TWOSUM_STREAM_PREFETCH < m) {
+            int x = xs[k + 2 * TWOSUM_STREAM_PREFETCH];
+            long want = s->target - x;
+            __builtin_prefetch(&map->ht[hash(x, map->bits)]);
+            if (want >= INT_MIN && want <= INT_MAX)
+                __builtin_prefetch(&map->ht[hash((int) want, map->bits)]);
+        }
+        if (k + TWOSUM_STREAM_PREFETCH < m) {
+            int x = xs[k + TWOSUM_STREAM_PREFETCH];
+            long want = s->target - x;
+            __builtin_prefetch(map->ht[hash(x, map->bits)].first);
+            if (want >= INT_MIN && want <= INT_MAX)
+                __builtin_prefetch(map->ht[hash((int) want, map->bits)].first);
+
+            size_t ahead = s->slot + TWOSUM_STREAM_PREFETCH;
+            if (ahead >= s->window)
+                ahead %= s->window;
+            if (s->events + TWOSUM_STREAM_PREFETCH >= s->window)
+                __builtin_prefetch(s->ring[ahead]);
+        }
+        if (twosum_stream_push(s, xs[k], &partner[k]))
+            pairs++;
+        else
+            partner[k] = UINT64_MAX;
+    }
+    return pairs;
+}
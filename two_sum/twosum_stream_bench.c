@@ -0,0 +1,156 @@
+/* Sliding-window twoSum throughput and memory over a long stream
+ *
+ * Build: gcc -O2 -o twosum_stream_bench twosum_stream_bench.c
+ * Usage: ./twosum_stream_bench [events] [max_window]
+ *
+ * Small windows are first checked against a scan of the last W events, and
+ * twosum_stream_push_batch() against single pushes. The stream then draws
+ * values from a range of about 4W, so a fair share of the events find a
+ * partner; it is pushed one event at a time and in batches of 4096. The
+ * process RSS is sampled after each quarter of the single-event stream. It
+ * should not move once the window has filled, and the bench exits with 1 if
+ * the last sample is more than 1 MiB plus 5% above the first one taken with
+ * the window full.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "twosum_stream.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double rss_mib(void)
+{
+    long pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%*s %ld", &pages) != 1)
+            pages = 0;
+        fclose(f);
+    }
+    return pages * (double) sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+static inline uint64_t xorshift64(uint64_t *s)
+{
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+static void run_checks(void)
+{
+    enum { N = 20000 };
+    static int xs[N];
+    uint64_t seed = 1;
+
+    for (size_t w = 1; w <= 1000; w = w * 3 + 1) {
+        long target = (long) (xorshift64(&seed) % 64) - 32;
+        twosum_stream_t *s = twosum_stream_init(w, target);
+        assert(s);
+        for (size_t n = 0; n < N; n++) {
+            xs[n] = (int) (xorshift64(&seed) % 64) - 32;
+            uint64_t partner;
+            bool found = twosum_stream_push(s, xs[n], &partner);
+
+            size_t m = n;
+            while (m-- > 0 && n - m < w && (long) xs[m] + xs[n] != target)
+                ;
+            bool expect = m < n && n - m < w;
+            assert(found == expect && (!found || partner == m));
+        }
+        assert(s->map->count <= w);
+        twosum_stream_free(s);
+
+        /* The batched path must give the same answers. */
+        static uint64_t partner[N];
+        s = twosum_stream_init(w, target);
+        twosum_stream_t *one = twosum_stream_init(w, target);
+        assert(s && one);
+        for (size_t n = 0; n < N; n += 1000)
+            twosum_stream_push_batch(s, xs + n, 1000, partner + n);
+        for (size_t n = 0; n < N; n++) {
+            uint64_t p = UINT64_MAX;
+            twosum_stream_push(one, xs[n], &p);
+            assert(p == partner[n]);
+        }
+        twosum_stream_free(s);
+        twosum_stream_free(one);
+    }
+    printf("checks passed\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t events = argc > 1 ? strtoull(argv[1], NULL, 10) : 1ULL << 27;
+    size_t max_window = argc > 2 ? strtoul(argv[2], NULL, 10) : 1 << 24;
+
+    run_checks();
+    int status = 0;
+    enum { BATCH = 4096 };
+    int *xs = malloc(sizeof(int) * BATCH);
+    uint64_t *partners = malloc(sizeof(uint64_t) * BATCH);
+    assert(xs && partners);
+
+    printf("%10s %8s %8s %10s %8s  %s\n", "window", "Mev/s", "batched",
+           "pairs", "entries", "rss MiB after each quarter");
+    for (size_t w = 1 << 10; w <= max_window; w <<= 4) {
+        twosum_stream_t *s = twosum_stream_init(w, 0);
+        assert(s);
+        uint64_t seed = 88172645463325252ULL, pairs = 0, partner;
+        long range = (long) w * 4;
+        double rss[4], t0 = now();
+        for (uint64_t n = 0; n < events; n++) {
+            int x = (int) ((long) (xorshift64(&seed) % range) - range / 2);
+            pairs += twosum_stream_push(s, x, &partner);
+            if ((n + 1) % (events / 4) == 0 && (n + 1) / (events / 4) <= 4)
+                rss[(n + 1) / (events / 4) - 1] = rss_mib();
+        }
+        double t = now() - t0;
+        size_t entries = s->map->count;
+        twosum_stream_free(s);
+
+        s = twosum_stream_init(w, 0);
+        assert(s);
+        seed = 88172645463325252ULL;
+        uint64_t batched = 0;
+        t0 = now();
+        for (uint64_t n = 0; n < events; n += BATCH) {
+            size_t m = events - n < BATCH ? events - n : BATCH;
+            for (size_t k = 0; k < m; k++)
+                xs[k] = (int) ((long) (xorshift64(&seed) % range) -
+                               range / 2);
+            batched += twosum_stream_push_batch(s, xs, m, partners);
+        }
+        double tb = now() - t0;
+        assert(batched == pairs);
+        twosum_stream_free(s);
+
+        printf("%10zu %8.1f %8.1f %10lu %8zu  %.1f %.1f %.1f %.1f\n", w,
+               events / t * 1e-6, events / tb * 1e-6, (unsigned long) pairs,
+               entries, rss[0], rss[1], rss[2], rss[3]);
+
+        int full = 0;
+        while (full < 4 && (full + 1) * (events / 4) < w)
+            full++;
+        if (full < 3 && rss[3] - rss[full] > 1 + rss[full] / 20) {
+            printf("%10s rss grew %.1f MiB after the window filled\n", "FAIL",
+                   rss[3] - rss[full]);
+            status = 1;
+        }
+    }
+    free(xs);
+    free(partners);
+    return status;
+}